@@ -7,16 +7,21 @@ import sys
 import json
 import platform
 import traceback
+import uuid
 from datetime import datetime, timezone
-from flask import Flask, render_template, request, jsonify, redirect, url_for, session, flash, send_file, send_from_directory
+from flask import Flask, render_template, request, jsonify, redirect, url_for, session, flash, send_file, send_from_directory, after_this_request
 from werkzeug.security import generate_password_hash, check_password_hash
 from functools import wraps
-from generate_certificate import generate_certificate
+from generate_certificate import generate_certificate, certificate_file_path, find_certificate_json, ENGINE_REPORT_KEY, engine_key_dir
+from device_inventory import DeviceInventory
 import requests
 
 # --- SECURE WIPING CORE (Python Native) ---
 import stat
 import time
+import threading
+import shutil
+import tempfile
 
 def secure_wipe_file(path, method='dod', flushes=True):
     """
@@ -121,9 +126,14 @@ from security_utils import (
     log_audit_event, check_rate_limit, increment_rate_limit,
     validate_license, get_client_ip, get_geolocation,
     get_user_statistics, require_license, require_rate_limit,
-    require_tos_acceptance, get_hardware_id, check_suspicious_activity
+    require_tos_acceptance, get_hardware_id, check_suspicious_activity,
+    init_audit_schema, get_audit_history, get_audit_log_page,
+    get_open_suspicious_page, get_audit_stats
 )
 
+# History indexes and aggregates (idempotent)
+init_audit_schema()
+
 # Import third-party verification system
 from verification_system import (
     register_certificate_for_verification,
@@ -155,6 +165,149 @@ else:
 C_EXECUTABLE_PATH = os.path.join('wipingEngine', executable_name)
 FAST_WIPE_PATH = 'fast_wipe.py'  # Python-based fast wiping engine
 
+def estimate_wipe_seconds(path, wipe_method):
+    """
+    Ask the engine for a wipe-time estimate (read-only; uses the throughput
+    history recorded by earlier disk wipes, or a short read probe).
+    Returns the parsed ESTIMATE_JSON dict, or None when unavailable.
+    """
+    if not os.path.exists(C_EXECUTABLE_PATH):
+        return None
+    try:
+        result = subprocess.run([C_EXECUTABLE_PATH, '--estimate', path, wipe_method],
+                                capture_output=True, text=True, timeout=60, check=False)
+    except (OSError, subprocess.TimeoutExpired):
+        return None
+    for line in result.stdout.splitlines():
+        if line.startswith('ESTIMATE_JSON '):
+            try:
+                return json.loads(line[len('ESTIMATE_JSON '):])
+            except ValueError:
+                return None
+    return None
+
+# --- Paged Directory Listing ---
+BROWSE_PAGE_SIZE = 500       # entries per /browse page unless ?limit= asks otherwise
+BROWSE_MAX_CURSORS = 64      # open directory cursors kept across requests
+BROWSE_CURSOR_TTL = 300      # seconds an idle cursor stays open
+SIZE_CACHE_ENTRIES = 128
+SIZE_CACHE_TTL = 60          # seconds; a deep change does not touch the top mtime
+SIZE_WALK_TIMEOUT = 900      # seconds one background --du walk may run
+SIZE_MAX_WALKS = 2           # background --du walks running at once
+
+_browse_cursors = {}         # cursor id -> {'iterator', 'path', 'user', 'last_used'}
+_size_cache = {}             # path -> (st_mtime_ns, fetched_at, summary or None if the walk failed)
+_size_walks = set()          # paths with a --du walk in flight
+_browse_lock = threading.Lock()
+
+def _close_cursor_locked(cursor_id):
+    entry = _browse_cursors.pop(cursor_id, None)
+    if entry:
+        entry['iterator'].close()
+
+def _expire_cursors_locked():
+    now = time.monotonic()
+    for cursor_id in [c for c, entry in _browse_cursors.items()
+                      if now - entry['last_used'] > BROWSE_CURSOR_TTL]:
+        _close_cursor_locked(cursor_id)
+    # Oldest first when still over the limit
+    while len(_browse_cursors) >= BROWSE_MAX_CURSORS:
+        oldest = min(_browse_cursors, key=lambda c: _browse_cursors[c]['last_used'])
+        _close_cursor_locked(oldest)
+
+def list_directory_page(path, cursor_id=None, limit=BROWSE_PAGE_SIZE, user=None):
+    """
+    One page of a directory listing. The directory is read with os.scandir, so
+    the file/folder split comes from d_type without a stat per entry, and the
+    open iterator is kept between requests: each page costs the same no matter
+    how large the directory is. Entries are sorted within the page only.
+    Returns (folders, files, next_cursor); next_cursor is None on the last page.
+    Raises KeyError if the cursor expired (the client restarts the listing).
+    """
+    with _browse_lock:
+        if cursor_id:
+            entry = _browse_cursors.pop(cursor_id, None)
+            if entry is None or entry['path'] != path or entry['user'] != user:
+                if entry:
+                    entry['iterator'].close()
+                raise KeyError(cursor_id)
+            iterator = entry['iterator']
+        else:
+            iterator = os.scandir(path)
+
+    folders, files = [], []
+    exhausted = False
+    try:
+        while len(folders) + len(files) < limit:
+            try:
+                item = next(iterator)
+            except StopIteration:
+                exhausted = True
+                break
+            try:
+                is_dir = item.is_dir()
+            except OSError:
+                is_dir = False
+            (folders if is_dir else files).append(item.name)
+    except Exception:
+        iterator.close()
+        raise
+
+    next_cursor = None
+    if exhausted:
+        iterator.close()
+    else:
+        next_cursor = uuid.uuid4().hex
+        with _browse_lock:
+            _expire_cursors_locked()
+            _browse_cursors[next_cursor] = {'iterator': iterator, 'path': path,
+                                            'user': user, 'last_used': time.monotonic()}
+    return sorted(folders), sorted(files), next_cursor
+
+def _run_size_walk(path, mtime_ns):
+    """Background --du walk for directory_size_summary; failures are cached too."""
+    summary = None
+    try:
+        if os.path.exists(C_EXECUTABLE_PATH):
+            result = subprocess.run([C_EXECUTABLE_PATH, '--du', path, '--clear'],
+                                    capture_output=True, text=True, timeout=SIZE_WALK_TIMEOUT, check=False)
+            for line in result.stdout.splitlines():
+                if line.startswith('SUMMARY_JSON '):
+                    summary = json.loads(line[len('SUMMARY_JSON '):])
+                    break
+    except (OSError, ValueError, subprocess.TimeoutExpired):
+        summary = None
+    finally:
+        with _browse_lock:
+            _size_walks.discard(path)
+            if len(_size_cache) >= SIZE_CACHE_ENTRIES:
+                _size_cache.pop(min(_size_cache, key=lambda p: _size_cache[p][1]))
+            _size_cache[path] = (mtime_ns, time.monotonic(), summary)
+
+def directory_size_summary(path):
+    """
+    Sizes of the folders directly inside path, from the engine's parallel
+    walker (--du). The walk runs in the background, so this never blocks:
+    returns ('ready', summary), ('failed', None) or ('pending', None).
+    Results, failures included, are cached while the directory's mtime is
+    unchanged.
+    """
+    try:
+        mtime_ns = os.stat(path).st_mtime_ns
+    except OSError:
+        return 'failed', None
+    with _browse_lock:
+        cached = _size_cache.get(path)
+        if cached and cached[0] == mtime_ns and time.monotonic() - cached[1] < SIZE_CACHE_TTL:
+            return ('ready', cached[2]) if cached[2] else ('failed', None)
+        if path in _size_walks:
+            return 'pending', None
+        if len(_size_walks) >= SIZE_MAX_WALKS:
+            return 'pending', None  # Started by a later poll once a walk finishes
+        _size_walks.add(path)
+    threading.Thread(target=_run_size_walk, args=(path, mtime_ns), daemon=True).start()
+    return 'pending', None
+
 # --- Platform Detection ---
 def detect_platform():
     """
@@ -350,7 +503,7 @@ def ata_secure_erase(disk_path):
     except Exception as e:
         return False, str(e)
 
-def get_physical_disks():
+def enumerate_physical_disks():
     """
     Get physical disks for Windows, Linux, and macOS.
     Mobile platforms (Android/iOS) will receive appropriate guidance.
@@ -446,6 +599,13 @@ def get_physical_disks():
     
     return disks
 
+# Disk list and per-drive SMART/firmware/HPA-DCO probes, cached until hot-plug or media change
+device_inventory = DeviceInventory(enumerate_physical_disks)
+
+def get_physical_disks():
+    """Physical disks from the device inventory (enumerated once, not per request)."""
+    return device_inventory.list_disks()
+
 # --- Decorators & Authentication ---
 def login_required(f):
     @wraps(f)
@@ -646,22 +806,24 @@ def wipe_tool():
 @app.route('/history')
 @login_required
 def history():
-    conn = get_db_connection()
+    before = request.args.get('before')
     try:
-        # Fetch audit logs for the current user
-        logs = conn.execute('''
-            SELECT timestamp, operation_type as type, device_path as path, 
-                   wipe_method as method, success
-            FROM audit_logs 
-            WHERE user_id = ? 
-            ORDER BY timestamp DESC
-        ''', (session['user_id'],)).fetchall()
-        return render_template('history.html', history=logs)
+        # One page of the current user's audit log, newest first
+        logs, next_before = get_audit_history(session['user_id'], before)
+        return render_template('history.html', history=logs, next_before=next_before,
+                               paged=bool(before), stats=get_audit_stats(session['user_id']))
     except Exception as e:
         flash(f"Error fetching history: {e}", "danger")
-        return render_template('history.html', history=[])
-    finally:
-        conn.close()
+        return render_template('history.html', history=[], next_before=None, paged=False, stats=None)
+
+@app.route('/disk-capabilities')
+@login_required
+def disk_capabilities():
+    """Pre-wipe analysis (SMART, firmware erase support, HPA/DCO) for one disk."""
+    disk_path = request.args.get('path')
+    if not disk_path or disk_path not in [disk['path'] for disk in get_physical_disks()]:
+        return jsonify({'error': 'Unknown disk'}), 404
+    return jsonify(device_inventory.get_capabilities(disk_path))
 
 @app.route('/browse')
 @login_required
@@ -703,11 +865,18 @@ def browse_fs():
         
         return jsonify({'current_path': '', 'folders': drives, 'files': []})
     
+    try:
+        limit = max(1, min(int(request.args.get('limit', BROWSE_PAGE_SIZE)), 5000))
+    except ValueError:
+        limit = BROWSE_PAGE_SIZE
+    
     try:
         requested_path = os.path.abspath(path)
-        items = os.listdir(requested_path)
-        folders = sorted([item for item in items if os.path.isdir(os.path.join(requested_path, item))])
-        files = sorted([item for item in items if not os.path.isdir(os.path.join(requested_path, item))])
+        try:
+            folders, files, next_cursor = list_directory_page(
+                requested_path, request.args.get('cursor'), limit, session.get('user_id'))
+        except KeyError:
+            return jsonify({"error": "Listing expired, please reload the folder.", "expired": True}), 410
         
         parent_path = os.path.dirname(requested_path)
         
@@ -715,23 +884,45 @@ def browse_fs():
         if platform_info['is_unix'] and parent_path == requested_path:
             parent_path = ''
         
-        return jsonify({
+        response = {
             'current_path': requested_path, 
             'parent_path': parent_path, 
             'folders': folders, 
-            'files': files
-        })
+            'files': files,
+            'next_cursor': next_cursor
+        }
+        
+        return jsonify(response)
     except PermissionError:
         return jsonify({"error": "Permission denied. Administrator/sudo privileges may be required."}), 403
     except Exception as e:
         return jsonify({"error": str(e)}), 500
 
+@app.route('/browse/sizes')
+@login_required
+def browse_sizes():
+    """Folder sizes for one directory. Computed in the background: poll while 202 comes back."""
+    path = request.args.get('path')
+    if not path or not os.path.isdir(path):
+        return jsonify({'error': 'Unknown folder'}), 404
+    state, summary = directory_size_summary(os.path.abspath(path))
+    if state == 'pending':
+        return jsonify({'status': 'pending'}), 202
+    if state == 'failed':
+        return jsonify({'status': 'failed', 'error': 'Folder sizes are unavailable for this folder.'})
+    return jsonify({
+        'status': 'ready',
+        'sizes': {entry['name']: entry['bytes'] for entry in summary.get('entries', [])},
+        'skipped_dirs': summary.get('skipped_dirs', 0)
+    })
+
 @app.route('/wipe-progress')
 @login_required
 def wipe_progress():
     """Server-Sent Events stream for real-time wipe progress updates."""
     path = request.args.get('path', '')
     wipe_type = request.args.get('type', 'file')
+    wipe_method = request.args.get('method', '--clear')
     
     def generate_progress():
         """Generate progress updates for the wipe operation."""
@@ -755,12 +946,19 @@ def wipe_progress():
                         except:
                             pass
             elif wipe_type == 'disk':
-                # For disk, estimate based on partition size
-                try:
-                    import shutil
-                    total_size = shutil.disk_usage(path).total
-                except:
-                    total_size = 1099511627776  # 1TB default
+                # Every pass rewrites the whole device: total is bytes x passes,
+                # paced by the engine's per-device throughput history
+                estimate = estimate_wipe_seconds(path, wipe_method)
+                if estimate and estimate.get('total_seconds', 0) > 0:
+                    total_size = estimate['bytes'] * len(estimate['pass_seconds'])
+                    estimated_seconds = estimate['total_seconds']
+                else:
+                    try:
+                        import shutil
+                        total_size = shutil.disk_usage(path).total
+                    except:
+                        total_size = 1099511627776  # 1TB default
+                    estimated_seconds = 300  # No estimate: assume 5min
             
             start_time = time.time()
             last_processed = 0
@@ -803,9 +1001,8 @@ def wipe_progress():
                         else:
                             processed = total_size
                     elif wipe_type == 'disk':
-                        # Disk wipe progresses based on time estimate (assume 5min for 1TB)
-                        speed_estimate_mbps = total_size / (1024 * 1024) / 300
-                        processed = min(speed_estimate_mbps * 1024 * 1024 * elapsed, total_size)
+                        # Disk wipe progresses along the engine's time estimate
+                        processed = min(total_size * elapsed / estimated_seconds, total_size)
                     
                     # Calculate speed (MB/s)
                     time_delta = current_time - last_time
@@ -828,6 +1025,8 @@ def wipe_progress():
                         'elapsed': int(elapsed),
                         'percent': int(progress_percent * 100)
                     }
+                    if wipe_type == 'disk':
+                        progress_data['eta'] = int(max(0, estimated_seconds - elapsed))
                     
                     yield f"data: {json.dumps(progress_data)}\n\n"
                     time.sleep(0.5)  # Update every 500ms
@@ -858,6 +1057,8 @@ def wipe_file_route():
     wipe_method = data.get('wipe_method')
     technician = data.get('technician', session.get('username', 'Unknown'))
     witness = data.get('witness', 'Not Specified')
+    # Opt-in: SSDs get the NIST 800-88 Clear sequence instead of multi-pass ('full' reads every block back)
+    media_aware = data.get('media_aware', False)
     
     if not all([wipe_type, path, wipe_method]):
         return jsonify({'stderr': 'ERROR: Missing parameters.'}), 400
@@ -892,6 +1093,7 @@ def wipe_file_route():
     wipe_result = 'Failure'  # Default to failure
     metadata_removed = False
     log_output = ''
+    engine_report_file = None
     
     # Handle ATA Secure Erase (Linux/Unix only)
     if wipe_method == "ata_secure_erase":
@@ -903,6 +1105,7 @@ def wipe_file_route():
             
         success, output = ata_secure_erase(path)
         log_output = output
+        device_inventory.invalidate(path)
         
         with open("wipe.log", "w", encoding='utf-8') as f:
             f.write(f"=== Data Wiping Operation Log ===\n")
@@ -1016,6 +1219,21 @@ def wipe_file_route():
             command = [sys.executable, FAST_WIPE_PATH, f'--{wipe_type}', path, turbo_method]
         else:
             command = [C_EXECUTABLE_PATH, f'--{wipe_type}', path, wipe_method]
+            if not platform_info['is_windows']:
+                # The engine signs a structured job report; the certificate is built from it.
+                # Key and report stay in the app's own 0700 key directory (never under a
+                # folder being wiped); the report's job directory is removed with the response.
+                job_dir = tempfile.mkdtemp(prefix='wipe_job_', dir=engine_key_dir(ENGINE_REPORT_KEY))
+                
+                @after_this_request
+                def remove_job_dir(response):
+                    shutil.rmtree(job_dir, ignore_errors=True)
+                    return response
+                
+                engine_report_file = os.path.join(job_dir, 'job_report.json')
+                command += [f'--report={engine_report_file}', f'--sign-key={ENGINE_REPORT_KEY}']
+                if wipe_type == 'disk' and media_aware:
+                    command.append('--media-aware=full' if media_aware == 'full' else '--media-aware')
         
         try:
             # Increased timeout to 7200 seconds (2 hours) and use unbuffered output for faster processing
@@ -1030,6 +1248,8 @@ def wipe_file_route():
             )
             process_returncode = process.returncode
             log_output = process.stdout + process.stderr
+            if wipe_type == 'disk':
+                device_inventory.invalidate(path)
         except subprocess.TimeoutExpired:
             return jsonify({'stderr': 'Wiping operation timed out. The drive may be too large.', 'success': False}), 500
         except Exception as e:
@@ -1121,7 +1341,9 @@ def wipe_file_route():
         cert_pdf = None
         try:
             print("Starting certificate generation...")
-            cert_json, cert_pdf = generate_certificate("wipe.log", path, platform_info, wipe_details)
+            report_file = engine_report_file if engine_report_file and os.path.exists(engine_report_file) else None
+            cert_json, cert_pdf = generate_certificate("wipe.log", path, platform_info, wipe_details,
+                                                       report_file=report_file, sign_key=ENGINE_REPORT_KEY)
             # Verify files were created
             print(f"Certificate files generated: JSON={cert_json}, PDF={cert_pdf}")
             
@@ -1221,7 +1443,8 @@ def download_file(filename):
     # Get the application root directory and certificates folder
     app_root = os.path.dirname(os.path.abspath(__file__))
     cert_dir = os.path.join(app_root, 'certificates')
-    file_path = os.path.join(cert_dir, filename)
+    # Batch certificates live in sharded subdirectories; the index resolves them
+    file_path = certificate_file_path(filename, cert_dir) or os.path.join(cert_dir, filename)
     
     print(f"Looking for file at: {file_path}")
     print(f"File exists: {os.path.exists(file_path)}")
@@ -1232,7 +1455,7 @@ def download_file(filename):
         try:
             # Determine MIME type
             mimetype = 'application/pdf' if filename.endswith('.pdf') else 'application/json'
-            return send_from_directory(cert_dir, filename, as_attachment=True, mimetype=mimetype)
+            return send_from_directory(os.path.dirname(file_path), filename, as_attachment=True, mimetype=mimetype)
         except Exception as e:
             print(f"Error sending file: {str(e)}")
             traceback.print_exc()
@@ -1273,10 +1496,12 @@ def verify_certificate():
     app_root = os.path.dirname(os.path.abspath(__file__))
     cert_dir = os.path.join(app_root, 'certificates')
     
-    # Search for certificate JSON file with matching ID
+    # Look the certificate up in the index, then fall back to scanning
+    # certificates written before the index existed
     cert_file = None
     try:
-        if os.path.exists(cert_dir):
+        cert_file = find_certificate_json(cert_id, cert_dir)
+        if not cert_file and os.path.exists(cert_dir):
             for filename in os.listdir(cert_dir):
                 if filename.endswith('.json') and filename.startswith('wipe_certificate_'):
                     file_path = os.path.join(cert_dir, filename)
@@ -1517,30 +1742,18 @@ def admin_audit_logs():
         return redirect(url_for('wipe_tool'))
     
     try:
-        conn = get_db_connection()
-        cursor = conn.cursor()
-        
-        # Get recent audit logs
-        cursor.execute('''
-            SELECT * FROM audit_logs 
-            ORDER BY timestamp DESC 
-            LIMIT 100
-        ''')
-        logs = cursor.fetchall()
+        # Get recent audit logs (?logs_before= continues from a previous page)
+        logs, logs_next = get_audit_log_page(request.args.get('logs_before'))
         
-        # Get suspicious activity
-        cursor.execute('''
-            SELECT * FROM suspicious_activity 
-            WHERE resolved = 0
-            ORDER BY detected_at DESC
-        ''')
-        suspicious = cursor.fetchall()
-        
-        conn.close()
+        # Get suspicious activity (?suspicious_before= likewise)
+        suspicious, suspicious_next = get_open_suspicious_page(request.args.get('suspicious_before'))
         
         return jsonify({
-            'audit_logs': [dict(row) for row in logs],
-            'suspicious_activity': [dict(row) for row in suspicious]
+            'audit_logs': logs,
+            'suspicious_activity': suspicious,
+            'next_logs_before': logs_next,
+            'next_suspicious_before': suspicious_next,
+            'totals': get_audit_stats()
         })
     except Exception as e:
         return jsonify({'error': str(e)}), 500
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+Device Inventory Cache for Zero Leaks
+Probes every drive once, in parallel, and keeps the results (disk list, SMART,
+ATA/NVMe capabilities, HPA/DCO state) until the device is unplugged, replaced
+or its media changes.
+"""
+
+import os
+import threading
+import time
+import platform
+from concurrent.futures import ThreadPoolExecutor
+from typing import Callable, Dict, List, Optional
+
+PROBE_WORKERS = 16         # drives probed at once (each runs its three tools side by side)
+INVENTORY_TTL = 300        # seconds; only used where there is no sysfs to watch
+
+
+class DeviceInventory:
+    """
+    Cached device inventory with change-driven invalidation.
+
+    On Linux each disk is fingerprinted from /sys/block (kobject inode, size
+    and WWID/serial). A hot-plug or re-plug creates a new kobject, and a media
+    change alters the size, so comparing fingerprints on every lookup is enough
+    to drop stale entries without rescanning. Other platforms fall back to a TTL.
+    """
+
+    def __init__(self, enumerate_disks: Callable[[], List[Dict]]):
+        self.enumerate_disks = enumerate_disks
+        self.sysfs = platform.system() == 'Linux' and os.path.isdir('/sys/block')
+        self.lock = threading.Lock()
+        self.disks: Optional[List[Dict]] = None
+        self.disks_time = 0.0
+        self.fingerprints: Dict[str, tuple] = {}
+        self.capabilities: Dict[str, Dict] = {}
+        self.pending: Dict[str, object] = {}
+        self.generations: Dict[str, int] = {}   # bumped whenever a disk's entry is dropped
+        # Separate pools: a drive probe waits on its tool probes, so they must
+        # never compete for the same worker slots
+        self.drive_pool = ThreadPoolExecutor(max_workers=PROBE_WORKERS, thread_name_prefix="drive-probe")
+        self.tool_pool = ThreadPoolExecutor(max_workers=PROBE_WORKERS * 3, thread_name_prefix="tool-probe")
+        self._analyzers = None
+
+    # ==================== CHANGE DETECTION ====================
+
+    def _read_sysfs(self, path):
+        try:
+            with open(path, 'r') as f:
+                return f.read().strip()
+        except OSError:
+            return None
+
+    def _fingerprint(self, name):
+        """Identity of /sys/block/<name>; None if the device is gone"""
+        base = os.path.join('/sys/block', name)
+        try:
+            inode = os.stat(base).st_ino
+        except OSError:
+            return None
+        ident = (self._read_sysfs(os.path.join(base, 'wwid')) or
+                 self._read_sysfs(os.path.join(base, 'device', 'wwid')) or
+                 self._read_sysfs(os.path.join(base, 'device', 'serial')))
+        return (inode, self._read_sysfs(os.path.join(base, 'size')), ident)
+
+    def _snapshot(self):
+        try:
+            return {name: self._fingerprint(name) for name in os.listdir('/sys/block')}
+        except OSError:
+            return {}
+
+    def _refresh_locked(self):
+        """Drop whatever changed since the last look (caller holds self.lock)"""
+        if not self.sysfs:
+            if time.monotonic() - self.disks_time > INVENTORY_TTL:
+                self.disks = None
+                for disk_path in list(self.capabilities) + list(self.pending):
+                    self._drop_locked(disk_path)
+            return
+
+        snapshot = self._snapshot()
+        if snapshot != self.fingerprints:
+            # Hot-plug or media change: the list (names, sizes) must be rebuilt,
+            # but only the drives that actually changed need probing again
+            self.disks = None
+            for name in snapshot.keys() | self.fingerprints.keys():
+                if self.fingerprints.get(name) != snapshot.get(name):
+                    self._drop_locked(os.path.join('/dev', name))
+        self.fingerprints = snapshot
+
+    # ==================== DISK LIST ====================
+
+    def list_disks(self) -> List[Dict]:
+        """Physical disks for the picker; enumerated only when the set changes"""
+        with self.lock:
+            self._refresh_locked()
+            if self.disks is None:
+                self.disks = self.enumerate_disks()
+                self.disks_time = time.monotonic()
+            disks = [dict(disk) for disk in self.disks]
+
+        # Warm the capability cache so pre-wipe analysis is ready on selection
+        self.probe_all(disks)
+        return disks
+
+    # ==================== CAPABILITIES ====================
+
+    def _get_analyzers(self):
+        # Constructed once: each checks for its tools (smartctl, hdparm, ...) on init
+        if self._analyzers is None:
+            from smart_analyzer import SMARTAnalyzer
+            from firmware_wiper import FirmwareLevelWiper
+            from hpa_dco_handler import HPADCOHandler
+            self._analyzers = (SMARTAnalyzer(), FirmwareLevelWiper(), HPADCOHandler())
+        return self._analyzers
+
+    def _probe(self, disk_path):
+        smart, firmware, hpa_dco = self._get_analyzers()
+        # The three tools talk to the same drive; run them side by side
+        futures = {
+            'smart': self.tool_pool.submit(smart.comprehensive_disk_analysis, disk_path),
+            'firmware': self.tool_pool.submit(firmware.analyze_drive_capabilities, disk_path),
+            'hpa_dco': self.tool_pool.submit(hpa_dco.detect_hpa_dco, disk_path),
+        }
+        result = {'disk_path': disk_path, 'probed_at': time.time()}
+        for key, future in futures.items():
+            try:
+                result[key] = future.result()
+            except Exception as e:
+                result[key] = {'errors': [f"{key} probe failed: {e}"]}
+        return result
+
+    def _probe_and_store(self, disk_path, generation):
+        try:
+            result = self._probe(disk_path)
+        except Exception:
+            with self.lock:
+                if self.generations.get(disk_path, 0) == generation:
+                    self.pending.pop(disk_path, None)  # let the next lookup retry
+            raise
+        with self.lock:
+            # A disk dropped mid-probe may already be a different device
+            if self.generations.get(disk_path, 0) == generation:
+                self.capabilities[disk_path] = result
+                self.pending.pop(disk_path, None)
+        return result
+
+    def _submit_probe_locked(self, disk_path):
+        future = self.pending.get(disk_path)
+        if future is None:
+            future = self.drive_pool.submit(self._probe_and_store, disk_path,
+                                            self.generations.get(disk_path, 0))
+            self.pending[disk_path] = future
+        return future
+
+    def _drop_locked(self, disk_path):
+        self.capabilities.pop(disk_path, None)
+        self.pending.pop(disk_path, None)
+        self.generations[disk_path] = self.generations.get(disk_path, 0) + 1
+
+    def probe_all(self, disks=None):
+        """Start probing every disk that has no cached capabilities"""
+        disks = disks if disks is not None else self.list_disks()
+        with self.lock:
+            for disk in disks:
+                if disk['path'] not in self.capabilities:
+                    self._submit_probe_locked(disk['path'])
+
+    def get_capabilities(self, disk_path, wait=True) -> Optional[Dict]:
+        """SMART, firmware and HPA/DCO results for one disk (probing on a miss)"""
+        with self.lock:
+            self._refresh_locked()
+            cached = self.capabilities.get(disk_path)
+            if cached is not None:
+                return cached
+            future = self._submit_probe_locked(disk_path)
+        return future.result() if wait else None
+
+    def invalidate(self, disk_path=None):
+        """Forget one disk (e.g. after a wipe changed HPA/DCO state) or everything"""
+        with self.lock:
+            if disk_path is None:
+                self.disks = None
+                for path in list(self.capabilities) + list(self.pending):
+                    self._drop_locked(path)
+            else:
+                self._drop_locked(disk_path)
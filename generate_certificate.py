@@ -1,6 +1,7 @@
 import subprocess, hashlib, json, base64, uuid, os, sys, platform, traceback
 from cryptography.hazmat.primitives import hashes, serialization
 from cryptography.hazmat.primitives.asymmetric import rsa, padding
+from cryptography.exceptions import InvalidSignature
 from cryptography.hazmat.backends import default_backend
 from datetime import datetime, timezone, timedelta
 from fpdf import FPDF
@@ -8,6 +9,7 @@ import qrcode
 from qrcode.image.pure import PyPNGImage
 import sqlite3
 import time
+from concurrent.futures import ProcessPoolExecutor
 
 # Compliance Standards Mapping
 COMPLIANCE_STANDARDS = {
@@ -132,6 +134,47 @@ def find_openssl_command():
     # Default to 'openssl' and let it fail if not found
     return 'openssl'
 
+# wipeEngine --report=FILE --sign-key=KEY signs its JSON job report with this
+# Ed25519 key (created by the engine on first use). Both halves live in a
+# directory only this user can open, so nobody else can swap the public key
+# that certificates trust.
+ENGINE_KEY_DIR = "engine_keys"
+ENGINE_REPORT_KEY = os.path.join(ENGINE_KEY_DIR, "engine_ed25519.pem")
+
+def engine_key_dir(key_file=ENGINE_REPORT_KEY):
+    """Create the engine key directory (mode 0700) and return it"""
+    key_dir = os.path.dirname(key_file) or "."
+    os.makedirs(key_dir, mode=0o700, exist_ok=True)
+    if os.name == "posix":
+        os.chmod(key_dir, 0o700)
+    return key_dir
+
+def engine_public_key_path(key_file=ENGINE_REPORT_KEY):
+    """Public half the engine writes next to its --sign-key (report_public_key_path in wipeEngine.c)"""
+    if len(key_file) > 4 and key_file.endswith(".pem"):
+        return key_file[:-4] + ".pub.pem"
+    return key_file + ".pub"
+
+def load_engine_report(report_file, sign_key=ENGINE_REPORT_KEY):
+    """
+    Load a wipeEngine job report and check its detached signature
+    (report_file + ".sig", base64 Ed25519 over the report's exact bytes)
+    against the public half of the --sign-key the engine was given.
+    Returns (report, report_bytes, signature_b64); raises if it does not verify.
+    """
+    public_key_file = engine_public_key_path(sign_key)
+    with open(report_file, "rb") as f:
+        report_bytes = f.read()
+    with open(report_file + ".sig", "r", encoding='utf-8') as f:
+        signature_b64 = f.read().strip()
+    with open(public_key_file, "rb") as f:
+        public_key = serialization.load_pem_public_key(f.read(), backend=default_backend())
+    try:
+        public_key.verify(base64.b64decode(signature_b64), report_bytes)
+    except InvalidSignature:
+        raise Exception(f"Engine report signature check failed for {report_file}")
+    return json.loads(report_bytes), report_bytes, signature_b64
+
 def utc_to_ist(utc_time_str):
     """Convert UTC time string to Indian Standard Time (IST = UTC+5:30)"""
     try:
@@ -150,6 +193,10 @@ def utc_to_ist(utc_time_str):
         return utc_time_str
 
 def store_certificate_to_db(cert_id, end_time, signature, verification_hash, db_file="users.db"):
+    store_certificates_to_db([(cert_id, end_time, signature, verification_hash)], db_file)
+
+def store_certificates_to_db(rows, db_file="users.db"):
+    """Insert (cert_id, end_time, signature, verification_hash) rows in one transaction."""
     conn = sqlite3.connect(db_file)
     c = conn.cursor()
     
@@ -160,8 +207,8 @@ def store_certificate_to_db(cert_id, end_time, signature, verification_hash, db_
         c.execute("ALTER TABLE certificates ADD COLUMN verification_hash TEXT")
         conn.commit()
     
-    c.execute("INSERT INTO certificates (cert_id, end_time, signature, verification_hash) VALUES (?, ?, ?, ?)",
-              (cert_id, end_time, signature, verification_hash))
+    c.executemany("INSERT INTO certificates (cert_id, end_time, signature, verification_hash) VALUES (?, ?, ?, ?)",
+                  rows)
     conn.commit()
     conn.close()
 
@@ -766,26 +813,26 @@ def generate_pdf_certificate(certificate, output_pdf, qr_file, compliance_info):
     # Save PDF
     pdf.output(output_pdf)
 
-def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, wipe_details=None):
+# Certificate store: single certificates go straight into CERT_DIR, batches are
+# sharded into CERT_DIR/<first two hex digits of the id>/ so no directory grows
+# without bound. CERT_INDEX_DB maps every filename (and certificate_id) to its
+# location so lookups never have to list or open the whole store.
+CERT_DIR = "certificates"
+CERT_INDEX_DB = "index.db"
+PRIVATE_KEY, PUBLIC_KEY = "signing_key.pem", "signing_pub.pem"
+
+# Per-process cache of the loaded RSA key and public key fingerprint
+_signing_context = None
+
+def get_signing_context():
     """
-    Generate a comprehensive digitally signed certificate for data wiping operation.
-    
-    Args:
-        log_file: Path to the wipe log file
-        path: Path that was wiped
-        platform_info: Dictionary containing platform information (OS, version, etc.)
-        wipe_details: Dictionary containing:
-            - wipe_method: The wiping algorithm used
-            - asset_serial: Hardware serial number (for disks)
-            - start_time: ISO format UTC timestamp when wipe started
-            - end_time: ISO format UTC timestamp when wipe ended
-            - wipe_result: "Success" or "Failure"
-            - technician: Name of technician performing wipe
-            - witness: Name of witness (optional)
-            - asset_type: "File", "Folder", or "Disk"
+    Load the RSA signing key (generating the pair on first use) and the public
+    key fingerprint once per process. Returns (private_key, pubkey_sha256).
     """
-    PRIVATE_KEY, PUBLIC_KEY = "signing_key.pem", "signing_pub.pem"
-    
+    global _signing_context
+    if _signing_context is not None:
+        return _signing_context
+
     # Generate RSA keys if they don't exist
     if not os.path.exists(PRIVATE_KEY):
         try:
@@ -817,66 +864,24 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
             traceback.print_exc()
             raise
 
-    # Generate unique certificate ID
-    unique_id = uuid.uuid4().hex
-    cert_reference_number = str(uuid.uuid4()).upper()  # Unique tracking UUID
-    
-    # Create certificates directory if it doesn't exist
-    CERT_DIR = "certificates"
-    os.makedirs(CERT_DIR, exist_ok=True)
-    
-    CERT_JSON = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}.json")
-    CERT_PDF = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}.pdf")
-    QR_FILE = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}_qr.png")
-    SIG_FILE = os.path.join(CERT_DIR, "wipe.sig")
-
-    # Read and hash the log file
+    # Load private key
     try:
-        with open(log_file, "rb") as f: 
-            log_data = f.read()
-        log_sha256 = hashlib.sha256(log_data).hexdigest()
-        print(f"Log file read successfully: {len(log_data)} bytes")
-    except Exception as e:
-        print(f"Error reading log file: {e}")
-        raise Exception(f"Cannot read log file {log_file}: {e}")
-
-    # Sign the log file
-    # Sign the log file
-    try:
-        # Load private key
         with open(PRIVATE_KEY, "rb") as key_file:
             private_key = serialization.load_pem_private_key(
                 key_file.read(),
                 password=None,
                 backend=default_backend()
             )
-        
-        # Sign the log data (log_data was read above)
-        # We sign the raw data; standard for digital signatures
-        signature = private_key.sign(
-            log_data,
-            padding.PKCS1v15(),
-            hashes.SHA256()
-        )
-        
-        with open(SIG_FILE, "wb") as f:
-            f.write(signature)
-            
-        print("Log file signed successfully (Software Mode)")
     except Exception as e:
-        print(f"Error signing log file: {e}")
+        print(f"Error loading signing key: {e}")
         traceback.print_exc()
         raise Exception(f"Signing failed: {e}")
-        
-    with open(SIG_FILE, "rb") as f: 
-        signature_b64 = base64.b64encode(f.read()).decode()
 
-    # Get public key fingerprint
     # Get public key fingerprint
     try:
         with open(PUBLIC_KEY, "rb") as f: 
             pubkey_data = f.read()
-        
+    
         # Calculate SHA256 of the public key file
         digest = hashes.Hash(hashes.SHA256(), backend=default_backend())
         digest.update(pubkey_data)
@@ -885,6 +890,57 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
         print(f"Error getting public key fingerprint: {e}")
         pubkey_sha256 = "N/A"
 
+    _signing_context = (private_key, pubkey_sha256)
+    return _signing_context
+
+def build_certificate(log_file="wipe.log", path="X://", platform_info=None, wipe_details=None, report_file=None,
+                      sign_key=ENGINE_REPORT_KEY):
+    """
+    Build and sign the certificate record for one wipe (no files are written).
+    Arguments are the same as generate_certificate().
+    Returns (certificate, compliance_info, unique_id).
+    """
+    engine_report = None
+    if report_file:
+        engine_report, report_bytes, signature_b64 = load_engine_report(report_file, sign_key)
+        log_sha256 = hashlib.sha256(report_bytes).hexdigest()
+        with open(engine_public_key_path(sign_key), "rb") as f:
+            pubkey_sha256 = hashlib.sha256(f.read()).hexdigest()
+        print(f"Engine report verified: {report_file} (job {engine_report.get('job_id')})")
+
+    # Generate unique certificate ID
+    unique_id = uuid.uuid4().hex
+    cert_reference_number = str(uuid.uuid4()).upper()  # Unique tracking UUID
+
+    # Read, hash and sign the log file (engine reports arrive signed)
+    if not engine_report:
+        # Read and hash the log file
+        try:
+            with open(log_file, "rb") as f: 
+                log_data = f.read()
+            log_sha256 = hashlib.sha256(log_data).hexdigest()
+            print(f"Log file read successfully: {len(log_data)} bytes")
+        except Exception as e:
+            print(f"Error reading log file: {e}")
+            raise Exception(f"Cannot read log file {log_file}: {e}")
+
+        # Sign the log file
+        private_key, pubkey_sha256 = get_signing_context()
+        try:
+            # We sign the raw data; standard for digital signatures
+            signature = private_key.sign(
+                log_data,
+                padding.PKCS1v15(),
+                hashes.SHA256()
+            )
+            print("Log file signed successfully (Software Mode)")
+        except Exception as e:
+            print(f"Error signing log file: {e}")
+            traceback.print_exc()
+            raise Exception(f"Signing failed: {e}")
+        
+        signature_b64 = base64.b64encode(signature).decode()
+
     # Parse wipe details
     if not wipe_details:
         wipe_details = {}
@@ -930,7 +986,7 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
         "wipe_result": wipe_details.get('wipe_result', 'Unknown'),
         "destruction_method": compliance_info['method_name'],
         "wipe_method_code": wipe_method,
-        "number_of_passes": compliance_info['passes'],
+        "number_of_passes": len(engine_report['passes']) if engine_report else compliance_info['passes'],
         
         # Compliance Information
         "compliance_standard": compliance_info['standard'],
@@ -947,7 +1003,8 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
         "log_sha256": log_sha256,
         "signature": signature_b64,
         "public_key_fingerprint_sha256": pubkey_sha256,
-        "verification_method": "SHA-256 Hash with RSA-2048 Digital Signature",
+        "verification_method": ("Engine-signed job report (Ed25519)" if engine_report
+                                else "SHA-256 Hash with RSA-2048 Digital Signature"),
         
         # Authorization
         "technician": wipe_details.get('technician', 'Not Specified'),
@@ -970,6 +1027,25 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
         "verification_passed": wipe_details.get('verification_passed', False),
     }
     
+    if engine_report:
+        # Read-back verification and coverage come from the engine itself
+        if engine_report['verify'].get('passed') is not None:
+            certificate["verification_passed"] = engine_report['verify']['passed']
+        certificate["engine_report"] = {
+            key: engine_report[key]
+            for key in ('job_id', 'target', 'passes', 'coverage', 'verify', 'defects', 'defects_dropped')
+        }
+        substitution = engine_report.get('media_substitution')
+        if substitution:
+            # --media-aware ran a different sequence than the one requested: say so on the certificate
+            certificate["media_substitution"] = substitution
+            certificate["destruction_method"] = "NIST Clear (flash: overwrite + discard)"
+            certificate["compliance_standard"] = substitution['standard']
+            certificate["method_description"] = (
+                f"Requested {substitution['requested']}; non-rotational media, so replaced by "
+                + ", ".join(substitution['steps']))
+            certificate["suitable_for"] = COMPLIANCE_STANDARDS['nist_clear']['suitable_for']
+    
     # Add platform information if provided
     if platform_info:
         certificate["platform"] = {
@@ -990,23 +1066,21 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
     verification_data = f"{certificate['certificate_id']}|{certificate['log_sha256']}|{certificate['signature']}|{certificate['finish_time_utc']}|{cert_reference_number}"
     certificate["verification_hash"] = hashlib.sha256(verification_data.encode()).hexdigest()
     certificate["anti_forgery_token"] = hashlib.sha256(f"{certificate['verification_hash']}|{PRIVATE_KEY}".encode()).hexdigest()
-    
-    # Save JSON certificate
-    with open(CERT_JSON, "w", encoding='utf-8') as f: 
-        json.dump(certificate, f, indent=4, ensure_ascii=False)
-    
-    # Store in database with verification hash
-    store_certificate_to_db(certificate["certificate_id"], certificate["finish_time_utc"], certificate["signature"], certificate["verification_hash"])
+    return certificate, compliance_info, unique_id
 
+def render_certificate(certificate, compliance_info, output_pdf, qr_file):
+    """Render the QR code and PDF for a built certificate record."""
     # Generate QR code with essential certificate data
+    path = certificate["asset_description"]
+    cert_reference_number = certificate["certificate_reference_number"]
     qr_data = {
         "ref": cert_reference_number,
         "asset": path[:50] + "..." if len(path) > 50 else path,
         "result": certificate["wipe_result"],
-        "method": compliance_info['method_name'][:30],
-        "standard": compliance_info['standard'],
-        "time": end_time_str,
-        "hash": log_sha256[:16] + "...",
+        "method": certificate['destruction_method'][:30],
+        "standard": certificate['compliance_standard'],
+        "time": certificate["finish_time_utc"],
+        "hash": certificate["log_sha256"][:16] + "...",
         "verify": f"https://verify.zeroleaks.com/{cert_reference_number}"
     }
     
@@ -1021,23 +1095,110 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
     qr.make(fit=True)
     
     qr_image = qr.make_image(fill_color="black", back_color="white")
-    qr_image.save(QR_FILE, format="PNG")
+    qr_image.save(qr_file, format="PNG")
 
     # Generate professional PDF certificate
     try:
-        generate_pdf_certificate(certificate, CERT_PDF, QR_FILE, compliance_info)
-        print(f"PDF certificate generated successfully: {CERT_PDF}")
+        generate_pdf_certificate(certificate, output_pdf, qr_file, compliance_info)
+        print(f"PDF certificate generated successfully: {output_pdf}")
     except Exception as pdf_error:
         print(f"Error generating PDF certificate: {pdf_error}")
         traceback.print_exc()
         raise Exception(f"PDF generation failed: {pdf_error}")
+    finally:
+        # Cleanup temporary files
+        try:
+            if os.path.exists(qr_file):
+                os.remove(qr_file)
+        except Exception as cleanup_error:
+            print(f"Warning: Could not cleanup temp files: {cleanup_error}")
 
-    # Cleanup temporary files
-    try:
-        os.remove(SIG_FILE)
-        os.remove(QR_FILE)
-    except Exception as cleanup_error:
-        print(f"Warning: Could not cleanup temp files: {cleanup_error}")
+def _open_certificate_index(cert_dir=CERT_DIR):
+    conn = sqlite3.connect(os.path.join(cert_dir, CERT_INDEX_DB))
+    conn.execute("""CREATE TABLE IF NOT EXISTS certificate_files (
+                        filename TEXT PRIMARY KEY,
+                        relpath TEXT NOT NULL,
+                        certificate_id TEXT)""")
+    conn.execute("CREATE INDEX IF NOT EXISTS idx_certificate_files_cert_id ON certificate_files(certificate_id)")
+    return conn
+
+def register_certificate_files(entries, cert_dir=CERT_DIR):
+    """Record (filename, relpath, certificate_id) rows in the certificate index."""
+    os.makedirs(cert_dir, exist_ok=True)
+    conn = _open_certificate_index(cert_dir)
+    with conn:
+        conn.executemany("INSERT OR REPLACE INTO certificate_files (filename, relpath, certificate_id) VALUES (?, ?, ?)",
+                         entries)
+    conn.close()
+
+def certificate_file_path(filename, cert_dir=CERT_DIR):
+    """
+    Resolve a certificate filename (wipe_certificate_<id>.pdf/.json) to its path
+    in the store. Falls back to the flat directory used by older certificates.
+    Returns None if the file does not exist.
+    """
+    if os.path.exists(os.path.join(cert_dir, CERT_INDEX_DB)):
+        conn = _open_certificate_index(cert_dir)
+        row = conn.execute("SELECT relpath FROM certificate_files WHERE filename = ?", (filename,)).fetchone()
+        conn.close()
+        if row and os.path.exists(os.path.join(cert_dir, row[0])):
+            return os.path.join(cert_dir, row[0])
+    flat_path = os.path.join(cert_dir, filename)
+    return flat_path if os.path.exists(flat_path) else None
+
+def find_certificate_json(certificate_id, cert_dir=CERT_DIR):
+    """Look up the JSON certificate for a certificate_id via the index, or None."""
+    if not os.path.exists(os.path.join(cert_dir, CERT_INDEX_DB)):
+        return None
+    conn = _open_certificate_index(cert_dir)
+    row = conn.execute("SELECT relpath FROM certificate_files WHERE certificate_id = ? AND filename LIKE '%.json'",
+                       (certificate_id,)).fetchone()
+    conn.close()
+    if row and os.path.exists(os.path.join(cert_dir, row[0])):
+        return os.path.join(cert_dir, row[0])
+    return None
+
+def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, wipe_details=None, report_file=None,
+                         sign_key=ENGINE_REPORT_KEY):
+    """
+    Generate a comprehensive digitally signed certificate for data wiping operation.
+    
+    Args:
+        log_file: Path to the wipe log file
+        path: Path that was wiped
+        platform_info: Dictionary containing platform information (OS, version, etc.)
+        wipe_details: Dictionary containing:
+            - wipe_method: The wiping algorithm used
+            - asset_serial: Hardware serial number (for disks)
+            - start_time: ISO format UTC timestamp when wipe started
+            - end_time: ISO format UTC timestamp when wipe ended
+            - wipe_result: "Success" or "Failure"
+            - technician: Name of technician performing wipe
+            - witness: Name of witness (optional)
+            - asset_type: "File", "Folder", or "Disk"
+        report_file: Engine-signed JSON job report (wipeEngine --report). When given,
+            its Ed25519 signature replaces hashing and RSA-signing the log.
+        sign_key: The --sign-key the engine signed report_file with; its public
+            half is the one trusted.
+    """
+    certificate, compliance_info, unique_id = build_certificate(log_file, path, platform_info, wipe_details,
+                                                                report_file, sign_key)
+    
+    # Create certificates directory if it doesn't exist
+    os.makedirs(CERT_DIR, exist_ok=True)
+    
+    CERT_JSON = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}.json")
+    CERT_PDF = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}.pdf")
+    QR_FILE = os.path.join(CERT_DIR, f"wipe_certificate_{unique_id}_qr.png")
+    
+    # Save JSON certificate
+    with open(CERT_JSON, "w", encoding='utf-8') as f: 
+        json.dump(certificate, f, indent=4, ensure_ascii=False)
+    
+    # Store in database with verification hash
+    store_certificate_to_db(certificate["certificate_id"], certificate["finish_time_utc"], certificate["signature"], certificate["verification_hash"])
+
+    render_certificate(certificate, compliance_info, CERT_PDF, QR_FILE)
     
     # Return absolute paths to ensure download route can find files
     cert_json_path = os.path.abspath(CERT_JSON)
@@ -1050,5 +1211,116 @@ def generate_certificate(log_file="wipe.log", path="X://", platform_info=None, w
     # Extract filename from path (e.g., "certificates/wipe_cert.json" -> "wipe_cert.json")
     json_filename = os.path.basename(CERT_JSON)
     pdf_filename = os.path.basename(CERT_PDF)
+    register_certificate_files([(json_filename, json_filename, certificate["certificate_id"]),
+                                (pdf_filename, pdf_filename, certificate["certificate_id"])])
     
     return json_filename, pdf_filename
+
+def _render_worker_init():
+    """Warm a render worker: load the core font metrics once per process."""
+    pdf = FPDF()
+    pdf.add_page()
+    for style in ("", "B", "I"):
+        pdf.set_font("Arial", style, 8)
+    pdf.set_font("Courier", "", 6)
+
+def _render_batch_item(certificate, compliance_info, output_pdf, qr_file):
+    try:
+        render_certificate(certificate, compliance_info, output_pdf, qr_file)
+        return None
+    except Exception as e:
+        return str(e)
+
+def generate_certificates_batch(jobs, workers=None, cert_dir=CERT_DIR, db_file="users.db"):
+    """
+    Generate certificates for a batch of completed wipes (e.g. a full drive rack).
+    
+    Each job is a dict of generate_certificate() keyword arguments (log_file, path,
+    platform_info, wipe_details, report_file, sign_key). Records are built and signed here
+    with the cached signing context; the QR/PDF rendering is spread over a pool
+    of worker processes. Only certificates whose PDF rendered are committed: the
+    JSON is written to cert_dir/<shard>/, the records are stored in a single
+    database transaction and the files are recorded in the certificate index.
+    
+    Returns one dict per job, in order: {"certificate_id", "json", "pdf"} on
+    success or {"error"} (with "certificate_id" once it was built) on failure.
+    """
+    results = []
+    pending = []
+    db_rows = []
+    index_rows = []
+    
+    for job in jobs:
+        try:
+            certificate, compliance_info, unique_id = build_certificate(**job)
+            shard = unique_id[:2]
+            os.makedirs(os.path.join(cert_dir, shard), exist_ok=True)
+        except Exception as e:
+            print(f"Batch certificate failed for {job.get('path')}: {e}")
+            results.append({"error": str(e)})
+            continue
+        
+        pending.append((len(results), shard, unique_id, certificate,
+                        (certificate, compliance_info,
+                         os.path.join(cert_dir, shard, f"wipe_certificate_{unique_id}.pdf"),
+                         os.path.join(cert_dir, shard, f"wipe_certificate_{unique_id}_qr.png"))))
+        results.append({"certificate_id": certificate["certificate_id"], "json": None, "pdf": None})
+    
+    # Render PDFs: inline for a single certificate, otherwise on a process pool
+    if len(pending) == 1 or workers == 1:
+        errors = [_render_batch_item(*item[4]) for item in pending]
+    elif pending:
+        with ProcessPoolExecutor(max_workers=workers, initializer=_render_worker_init) as pool:
+            futures = [pool.submit(_render_batch_item, *item[4]) for item in pending]
+            errors = []
+            for future in futures:
+                try:
+                    errors.append(future.result())
+                except Exception as e:  # A render process died; its certificate fails
+                    errors.append(str(e))
+    else:
+        errors = []
+    
+    for (slot, shard, unique_id, certificate, render_args), error in zip(pending, errors):
+        json_name = f"wipe_certificate_{unique_id}.json"
+        pdf_name = f"wipe_certificate_{unique_id}.pdf"
+        if not error:
+            try:
+                with open(os.path.join(cert_dir, shard, json_name), "w", encoding='utf-8') as f:
+                    json.dump(certificate, f, indent=4, ensure_ascii=False)
+            except OSError as e:
+                error = str(e)
+        if error:
+            # Nothing of a failed certificate is committed; drop any partial PDF
+            print(f"Batch certificate {certificate['certificate_id']} failed: {error}")
+            results[slot]["error"] = error
+            try:
+                os.remove(render_args[2])
+            except OSError:
+                pass
+            continue
+        
+        cert_id = certificate["certificate_id"]
+        db_rows.append((cert_id, certificate["finish_time_utc"], certificate["signature"], certificate["verification_hash"]))
+        index_rows.append((json_name, os.path.join(shard, json_name), cert_id))
+        index_rows.append((pdf_name, os.path.join(shard, pdf_name), cert_id))
+        results[slot].update({"json": json_name, "pdf": pdf_name})
+    
+    if db_rows:
+        store_certificates_to_db(db_rows, db_file)
+    if index_rows:
+        register_certificate_files(index_rows, cert_dir)
+    
+    print(f"Batch complete: {sum(1 for r in results if r.get('pdf'))}/{len(results)} certificates rendered")
+    return results
+
+if __name__ == "__main__":
+    # python generate_certificate.py --batch jobs.json [--workers N]
+    import argparse
+    parser = argparse.ArgumentParser(description="Generate wipe certificates")
+    parser.add_argument("--batch", required=True, help="JSON file with a list of generate_certificate() jobs")
+    parser.add_argument("--workers", type=int, default=None, help="Render processes (default: CPU count)")
+    args = parser.parse_args()
+    with open(args.batch, "r", encoding='utf-8') as f:
+        batch_jobs = json.load(f)
+    print(json.dumps(generate_certificates_batch(batch_jobs, workers=args.workers), indent=4))
@@ -7,6 +7,7 @@ Enables certificate generation and wiping without network connectivity
 import json
 import os
 import sqlite3
+import time
 import uuid
 from datetime import datetime, timezone
 from generate_certificate import generate_certificate, COMPLIANCE_STANDARDS
@@ -47,10 +48,19 @@ class OfflineHandler:
                 json_path TEXT,
                 created_timestamp TEXT NOT NULL,
                 sync_status TEXT DEFAULT 'pending',
-                wipe_log TEXT
+                wipe_log TEXT,
+                retry_count INTEGER DEFAULT 0,
+                last_error TEXT
             )
         ''')
         
+        # Older offline databases predate the sync bookkeeping columns
+        c.execute('PRAGMA table_info(offline_certificates)')
+        existing = {row[1] for row in c.fetchall()}
+        for col_name, col_def in [('retry_count', 'INTEGER DEFAULT 0'), ('last_error', 'TEXT')]:
+            if col_name not in existing:
+                c.execute(f'ALTER TABLE offline_certificates ADD COLUMN {col_name} {col_def}')
+        
         # Create table for queued operations
         c.execute('''
             CREATE TABLE IF NOT EXISTS operation_queue (
@@ -155,8 +165,12 @@ class OfflineHandler:
         print(f"📋 Operation queued for sync: {operation} (ID: {op_id})")
         return op_id
     
-    def sync_offline_operations(self):
-        """Sync all pending offline operations when network is available"""
+    def sync_offline_operations(self, progress=None):
+        """
+        Sync all pending offline operations when network is available.
+        progress, if given, is called with a dict for each sync step
+        (see _sync_certificates); by default the steps are printed.
+        """
         
         if not self.is_online():
             print("📴 No network connectivity - cannot sync operations")
@@ -165,7 +179,7 @@ class OfflineHandler:
         print("🔄 Network detected - syncing offline operations...")
         
         # Sync certificates
-        synced_certs = self._sync_certificates()
+        synced_certs = self._sync_certificates(progress or self._print_sync_progress)
         
         # Sync queued operations  
         synced_ops = self._sync_queued_operations()
@@ -173,81 +187,128 @@ class OfflineHandler:
         print(f"✅ Sync complete: {synced_certs} certificates, {synced_ops} operations")
         return True
     
-    def _sync_certificates(self):
-        """Sync offline certificates to main database"""
+    def _print_sync_progress(self, event):
+        stage = event['stage']
+        if stage == 'staged':
+            print(f"📦 {event['pending']} pending certificates staged for sync")
+        elif stage == 'failed':
+            print(f"❌ Failed to sync certificate {event['cert_id']}: {event['error']}")
+        elif stage == 'committed':
+            print(f"📤 Synced {event['synced']} certificates ({event['failed']} failed) in {event['seconds']:.2f}s")
+    
+    def _sync_certificates(self, progress=None, main_db="users.db"):
+        """
+        Sync offline certificates to the main database in one transaction.
+        
+        Both databases are attached to one connection and the pending rows are
+        moved with set-based statements: the certificate JSON is parsed by
+        SQLite's json functions, rows that do not parse or lack a field are
+        marked failed with the reason, and the rest are upserted together.
+        The main database is locked once for the whole batch rather than once
+        per certificate. progress receives {'stage': 'staged' | 'failed' |
+        'committed', ...} as the sync proceeds.
+        """
         
-        conn = sqlite3.connect(self.offline_db)
-        c = conn.cursor()
+        progress = progress or (lambda event: None)
+        start = time.monotonic()
         
-        # Get pending certificates
-        c.execute('''
-            SELECT cert_id, cert_data, created_timestamp 
-            FROM offline_certificates 
-            WHERE sync_status = 'pending'
-        ''')
-        
-        certificates = c.fetchall()
-        synced_count = 0
+        conn = sqlite3.connect(self.offline_db, timeout=30)
+        conn.isolation_level = None  # transactions are managed explicitly below
+        c = conn.cursor()
+        c.execute('ATTACH DATABASE ? AS main_db', (main_db,))
         
-        for cert_id, cert_data, timestamp in certificates:
-            try:
-                # Parse certificate data
-                cert_json = json.loads(cert_data)
-                
-                # Store in main database
-                main_conn = sqlite3.connect("users.db")
-                main_c = main_conn.cursor()
-                
-                # Ensure certificates table exists
-                main_c.execute('''
-                    CREATE TABLE IF NOT EXISTS certificates (
-                        cert_id TEXT PRIMARY KEY,
-                        end_time TEXT NOT NULL,
-                        signature TEXT NOT NULL,
-                        verification_hash TEXT NOT NULL,
-                        created_offline INTEGER DEFAULT 0,
-                        sync_timestamp TEXT
+        try:
+            c.execute('''
+                CREATE TABLE IF NOT EXISTS main_db.certificates (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    cert_id TEXT NOT NULL UNIQUE,
+                    end_time TEXT NOT NULL,
+                    signature TEXT NOT NULL
+                )
+            ''')
+            
+            # Columns the sync writes; older main databases lack them
+            c.execute('PRAGMA main_db.table_info(certificates)')
+            existing = {row[1] for row in c.fetchall()}
+            for col_name, col_def in [('verification_hash', 'TEXT'),
+                                      ('created_offline', 'INTEGER DEFAULT 0'),
+                                      ('sync_timestamp', 'TEXT')]:
+                if col_name not in existing:
+                    c.execute(f'ALTER TABLE main_db.certificates ADD COLUMN {col_name} {col_def}')
+            
+            c.execute('BEGIN IMMEDIATE')
+            
+            # Parse every pending certificate once; `error` is NULL for good rows
+            c.execute('DROP TABLE IF EXISTS temp.sync_batch')
+            c.execute('''
+                CREATE TEMP TABLE sync_batch AS
+                SELECT cert_id, certificate_id, end_time, signature, verification_hash,
+                       CASE
+                           WHEN NOT valid THEN 'malformed certificate JSON'
+                           WHEN certificate_id IS NULL THEN 'missing certificate_id'
+                           WHEN end_time IS NULL THEN 'missing finish_time_utc'
+                           WHEN signature IS NULL THEN 'missing signature'
+                           WHEN verification_hash IS NULL THEN 'missing verification_hash'
+                       END AS error
+                FROM (
+                    SELECT cert_id, valid,
+                           CASE WHEN valid THEN json_extract(cert_data, '$.certificate_id') END AS certificate_id,
+                           CASE WHEN valid THEN json_extract(cert_data, '$.finish_time_utc') END AS end_time,
+                           CASE WHEN valid THEN json_extract(cert_data, '$.signature') END AS signature,
+                           CASE WHEN valid THEN json_extract(cert_data, '$.verification_hash') END AS verification_hash
+                    FROM (
+                        SELECT cert_id, cert_data, json_valid(cert_data) AS valid
+                        FROM offline_certificates
+                        WHERE sync_status = 'pending'
                     )
-                ''')
-                
-                # Insert certificate
-                main_c.execute('''
-                    INSERT OR REPLACE INTO certificates 
-                    (cert_id, end_time, signature, verification_hash, created_offline, sync_timestamp)
-                    VALUES (?, ?, ?, ?, 1, ?)
-                ''', (
-                    cert_json['certificate_id'],
-                    cert_json['finish_time_utc'],
-                    cert_json['signature'],
-                    cert_json['verification_hash'],
-                    datetime.now(timezone.utc).isoformat()
-                ))
-                
-                main_conn.commit()
-                main_conn.close()
-                
-                # Update sync status
-                c.execute('''
-                    UPDATE offline_certificates 
-                    SET sync_status = 'completed', retry_count = retry_count + 1
-                    WHERE cert_id = ?
-                ''', (cert_id,))
-                
-                synced_count += 1
-                print(f"📤 Synced certificate: {cert_json['certificate_id']}")
-                
-            except Exception as e:
-                # Mark as failed
-                c.execute('''
-                    UPDATE offline_certificates 
-                    SET sync_status = 'failed', last_error = ?, retry_count = retry_count + 1
-                    WHERE cert_id = ?
-                ''', (str(e), cert_id))
-                print(f"❌ Failed to sync certificate {cert_id}: {e}")
+                )
+            ''')
+            pending = c.execute('SELECT COUNT(*) FROM sync_batch').fetchone()[0]
+            progress({'stage': 'staged', 'pending': pending})
+            
+            # Several offline rows may carry the same certificate; the last one wins
+            c.execute('''
+                INSERT INTO main_db.certificates
+                (cert_id, end_time, signature, verification_hash, created_offline, sync_timestamp)
+                SELECT certificate_id, end_time, signature, verification_hash, 1, ?
+                FROM sync_batch
+                WHERE error IS NULL
+                  AND rowid IN (SELECT MAX(rowid) FROM sync_batch WHERE error IS NULL GROUP BY certificate_id)
+                ON CONFLICT(cert_id) DO UPDATE SET
+                    end_time = excluded.end_time,
+                    signature = excluded.signature,
+                    verification_hash = excluded.verification_hash,
+                    created_offline = 1,
+                    sync_timestamp = excluded.sync_timestamp
+            ''', (datetime.now(timezone.utc).isoformat(),))
+            
+            # Update sync status for the whole batch at once
+            c.execute('''
+                UPDATE offline_certificates
+                SET sync_status = CASE
+                        WHEN (SELECT error FROM sync_batch b WHERE b.cert_id = offline_certificates.cert_id) IS NULL
+                        THEN 'completed' ELSE 'failed' END,
+                    last_error = (SELECT error FROM sync_batch b WHERE b.cert_id = offline_certificates.cert_id),
+                    retry_count = retry_count + 1
+                WHERE cert_id IN (SELECT cert_id FROM sync_batch)
+            ''')
+            
+            failures = c.execute('SELECT cert_id, error FROM sync_batch WHERE error IS NOT NULL').fetchall()
+            c.execute('COMMIT')
+        except Exception:
+            if conn.in_transaction:
+                c.execute('ROLLBACK')
+            conn.close()
+            raise
         
-        conn.commit()
         conn.close()
         
+        for cert_id, error in failures:
+            progress({'stage': 'failed', 'cert_id': cert_id, 'error': error})
+        synced_count = pending - len(failures)
+        progress({'stage': 'committed', 'synced': synced_count, 'failed': len(failures),
+                  'seconds': time.monotonic() - start})
+        
         return synced_count
     
     def _sync_queued_operations(self):
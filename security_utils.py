@@ -5,6 +5,9 @@ Comprehensive security features to prevent misuse of the data wiping application
 
 import sqlite3
 import hashlib
+import threading
+import queue
+import atexit
 import uuid
 import platform
 import socket
@@ -73,11 +76,12 @@ def get_geolocation(ip_address):
         'real_ip': ip_address
     }
 
-def is_vpn_or_proxy(ip_address):
-    """Detect if user is using VPN or proxy (basic check)"""
+def is_vpn_or_proxy(ip_address, geo=None):
+    """Detect if user is using VPN or proxy (basic check); pass geo to skip the lookup"""
     try:
         # Check common VPN/proxy indicators
-        geo = get_geolocation(ip_address)
+        if geo is None:
+            geo = get_geolocation(ip_address)
         isp = geo.get('isp', '').lower()
         
         vpn_keywords = ['vpn', 'proxy', 'tunnel', 'tor', 'anonymizer', 'hide', 'privacy']
@@ -124,9 +128,126 @@ def get_system_fingerprint():
         'hardware_id': get_hardware_id()
     }
 
+# ==================== AUDIT WRITER ====================
+
+AUDIT_DB = 'users.db'
+AUDIT_BATCH_MAX = 256               # statements committed per transaction
+AUDIT_FLUSH_INTERVAL = 0.5          # seconds the writer waits for a batch to fill
+
+class AuditWriter:
+    """
+    Single background writer for audit rows in users.db. Request threads
+    enqueue statements and return immediately; the writer commits them in
+    batched transactions (WAL, synchronous=NORMAL). A statement submitted with
+    wait=True blocks its caller until its batch is committed and synced to
+    disk, for security events that must not be lost in a crash.
+    after_commit callbacks run in order on a separate callback thread once
+    their row is committed, so a slow callback never holds up the writes.
+    """
+    def __init__(self, db_file=AUDIT_DB):
+        self.db_file = db_file
+        self.queue = queue.Queue()
+        self.callbacks = queue.Queue()
+        self.thread = None
+        self.start_lock = threading.Lock()
+
+    def start(self):
+        with self.start_lock:
+            if self.thread is None:
+                threading.Thread(target=self._run_callbacks, name="audit-callbacks", daemon=True).start()
+                self.thread = threading.Thread(target=self._run, name="audit-writer", daemon=True)
+                self.thread.start()
+                atexit.register(self.flush)
+
+    def submit(self, sql, params=(), after_commit=None, wait=False):
+        self.start()
+        committed = threading.Event() if wait else None
+        self.queue.put((sql, params, after_commit, committed))
+        if committed:
+            committed.wait()
+
+    def flush(self):
+        """Block until everything queued so far is on disk"""
+        if self.thread is None:
+            return
+        self.queue.put((None, None, None, None))
+        self.queue.join()
+        # Callbacks may queue rows of their own (suspicious_activity)
+        self.callbacks.join()
+        self.queue.join()
+
+    def _run(self):
+        conn = sqlite3.connect(self.db_file)
+        conn.execute('PRAGMA journal_mode=WAL')
+        conn.execute('PRAGMA synchronous=NORMAL')
+        
+        while True:
+            try:
+                batch = [self.queue.get(timeout=AUDIT_FLUSH_INTERVAL)]
+            except queue.Empty:
+                batch = []
+            while batch and len(batch) < AUDIT_BATCH_MAX:
+                try:
+                    batch.append(self.queue.get_nowait())
+                except queue.Empty:
+                    break
+            
+            statements = [(sql, params) for sql, params, _, _ in batch if sql]
+            # A waited-for or flushed batch is synced like a plain commit would be
+            durable = any(committed or not sql for sql, _, _, committed in batch)
+            if durable:
+                conn.execute('PRAGMA synchronous=FULL')
+            try:
+                with conn:
+                    for sql, params in statements:
+                        conn.execute(sql, params)
+            except Exception as e:
+                # One bad row must not cost the rest of the batch
+                print(f"Audit writer batch error: {e}")
+                for sql, params in statements:
+                    try:
+                        with conn:
+                            conn.execute(sql, params)
+                    except Exception as row_error:
+                        print(f"Audit writer dropped statement: {row_error}")
+            if durable:
+                conn.execute('PRAGMA synchronous=NORMAL')
+            
+            for _, _, after_commit, committed in batch:
+                if committed:
+                    committed.set()
+                if after_commit:
+                    self.callbacks.put(after_commit)
+            for _ in batch:
+                self.queue.task_done()
+
+    def _run_callbacks(self):
+        while True:
+            after_commit = self.callbacks.get()
+            try:
+                after_commit()
+            except Exception as e:
+                print(f"Audit writer callback error: {e}")
+            finally:
+                self.callbacks.task_done()
+
+audit_writer = AuditWriter()
+
+# Shared read connection; under WAL readers never wait on the writer
+_reader_conn = None
+_reader_lock = threading.Lock()
+
+def audit_query(sql, params=()):
+    """Run a read-only query against users.db and return all rows"""
+    global _reader_conn
+    with _reader_lock:
+        if _reader_conn is None:
+            _reader_conn = sqlite3.connect(AUDIT_DB, check_same_thread=False)
+        return _reader_conn.execute(sql, params).fetchall()
+
 # ==================== AUDIT LOGGING ====================
 
-def log_audit_event(user_id, username, operation_type, purpose=None, **kwargs):
+def log_audit_event(user_id, username, operation_type, purpose=None, durable=False, **kwargs):
     """
     Comprehensive audit logging for all operations
     
@@ -135,12 +256,10 @@ def log_audit_event(user_id, username, operation_type, purpose=None, **kwargs):
         username: Username
         operation_type: Type of operation (wipe, verify, etc.)
         purpose: User-provided reason for the operation (optional, defaults to None)
+        durable: Wait until the row is on disk instead of returning once it is queued
         **kwargs: Additional information (device_path, wipe_method, etc.)
     """
     try:
-        conn = sqlite3.connect('users.db')
-        cursor = conn.cursor()
-        
         # Gather all tracking information
         ip_address = get_client_ip()
         user_agent = request.headers.get('User-Agent', 'Unknown')
@@ -152,7 +271,10 @@ def log_audit_event(user_id, username, operation_type, purpose=None, **kwargs):
         
         timestamp = datetime.now().isoformat()
         
-        cursor.execute('''
+        # Queued for the audit writer; the suspicious-activity check runs once
+        # the row is committed so its counts include this event, and reuses
+        # this geolocation rather than looking the IP up again
+        audit_writer.submit('''
             INSERT INTO audit_logs (
                 user_id, username, operation_type, device_path, wipe_method,
                 purpose, ip_address, user_agent, geolocation, country_code,
@@ -173,50 +295,171 @@ def log_audit_event(user_id, username, operation_type, purpose=None, **kwargs):
             kwargs.get('certificate_id', 'N/A'),
             str(hardware_info),
             kwargs.get('success', 1)
-        ))
+        ), after_commit=lambda: check_suspicious_activity(user_id, operation_type, ip_address, geo_info),
+           wait=durable)
         
+        return True
+    except Exception as e:
+        print(f"Audit logging error: {e}")
+        return False
+
+# ==================== AUDIT HISTORY ====================
+
+AUDIT_PAGE_SIZE = 50
+AUDIT_STATS_GLOBAL = 0   # audit_stats row for all users (user ids start at 1)
+
+def init_audit_schema(db_file=AUDIT_DB):
+    """
+    Indexes for the history and admin pages, and the audit_stats aggregates a
+    trigger keeps current on every audit_logs insert. Safe to run on every start.
+    """
+    try:
+        conn = sqlite3.connect(db_file)
+        conn.execute('BEGIN IMMEDIATE')
+        # Keyset pages walk these in (time, id) order; id is the rowid, which
+        # every index already ends with
+        conn.execute('CREATE INDEX IF NOT EXISTS idx_audit_logs_user_time ON audit_logs(user_id, timestamp)')
+        conn.execute('CREATE INDEX IF NOT EXISTS idx_audit_logs_time ON audit_logs(timestamp)')
+        conn.execute('CREATE INDEX IF NOT EXISTS idx_suspicious_open ON suspicious_activity(resolved, detected_at)')
+        
+        created = not conn.execute(
+            "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'audit_stats'").fetchone()
+        conn.execute('''
+            CREATE TABLE IF NOT EXISTS audit_stats (
+                user_id INTEGER PRIMARY KEY,
+                total_operations INTEGER DEFAULT 0,
+                successful_operations INTEGER DEFAULT 0,
+                last_timestamp TEXT
+            )
+        ''')
+        conn.execute(f'''
+            CREATE TRIGGER IF NOT EXISTS audit_stats_on_insert AFTER INSERT ON audit_logs
+            BEGIN
+                INSERT INTO audit_stats (user_id, total_operations, successful_operations, last_timestamp)
+                VALUES (NEW.user_id, 1, COALESCE(NEW.success, 1) != 0, NEW.timestamp),
+                       ({AUDIT_STATS_GLOBAL}, 1, COALESCE(NEW.success, 1) != 0, NEW.timestamp)
+                ON CONFLICT(user_id) DO UPDATE SET
+                    total_operations = total_operations + 1,
+                    successful_operations = successful_operations + excluded.successful_operations,
+                    last_timestamp = max(COALESCE(last_timestamp, ''), excluded.last_timestamp);
+            END
+        ''')
+        if created:
+            # Existing rows predate the trigger; count them once
+            conn.execute(f'''
+                INSERT INTO audit_stats (user_id, total_operations, successful_operations, last_timestamp)
+                SELECT user_id, COUNT(*), SUM(COALESCE(success, 1) != 0), MAX(timestamp)
+                FROM audit_logs GROUP BY user_id
+                UNION ALL
+                SELECT {AUDIT_STATS_GLOBAL}, COUNT(*), COALESCE(SUM(COALESCE(success, 1) != 0), 0), MAX(timestamp)
+                FROM audit_logs
+            ''')
         conn.commit()
         conn.close()
-        
-        # Check for suspicious activity
-        check_suspicious_activity(user_id, operation_type, ip_address, geo_info)
-        
         return True
     except Exception as e:
-        print(f"Audit logging error: {e}")
+        print(f"Audit schema error: {e}")
         return False
 
+def _parse_page_cursor(before):
+    """'<timestamp>|<id>' from a previous page, or None for the first page"""
+    if not before:
+        return None
+    timestamp, _, row_id = before.rpartition('|')
+    try:
+        return timestamp, int(row_id)
+    except ValueError:
+        return None
+
+def _keyset_page(select, where, params, time_column, before, limit):
+    """
+    One page of rows newest first, starting after the `before` cursor. Seeks
+    straight to the cursor in the (.., time) index, so page N costs the same as
+    page 1. Returns (rows as dicts, cursor for the next page or None).
+    """
+    global _reader_conn
+    cursor = _parse_page_cursor(before)
+    if cursor:
+        where = f'{where} AND ({time_column}, id) < (?, ?)'
+        params = tuple(params) + cursor
+    
+    with _reader_lock:
+        if _reader_conn is None:
+            _reader_conn = sqlite3.connect(AUDIT_DB, check_same_thread=False)
+        result = _reader_conn.execute(f'''
+            {select} WHERE {where}
+            ORDER BY {time_column} DESC, id DESC
+            LIMIT ?
+        ''', tuple(params) + (limit + 1,))
+        columns = [c[0] for c in result.description]
+        rows = [dict(zip(columns, row)) for row in result.fetchall()]
+    
+    next_before = None
+    if len(rows) > limit:
+        rows = rows[:limit]
+        next_before = f"{rows[-1][time_column]}|{rows[-1]['id']}"
+    return rows, next_before
+
+def get_audit_history(user_id, before=None, limit=AUDIT_PAGE_SIZE):
+    """A user's wipe history, one page at a time"""
+    return _keyset_page('''
+        SELECT id, timestamp, operation_type AS type, device_path AS path,
+               wipe_method AS method, success
+        FROM audit_logs
+    ''', 'user_id = ?', (user_id,), 'timestamp', before, limit)
+
+def get_audit_log_page(before=None, limit=100):
+    """All users' audit log, one page at a time (admin)"""
+    return _keyset_page('SELECT * FROM audit_logs', '1', (), 'timestamp', before, limit)
+
+def get_open_suspicious_page(before=None, limit=100):
+    """Unresolved suspicious activity, one page at a time (admin)"""
+    return _keyset_page('SELECT * FROM suspicious_activity', 'resolved = 0', (),
+                        'detected_at', before, limit)
+
+def get_audit_stats(user_id=AUDIT_STATS_GLOBAL):
+    """Precomputed operation counts for one user (or everyone)"""
+    rows = audit_query('''
+        SELECT total_operations, successful_operations, last_timestamp
+        FROM audit_stats WHERE user_id = ?
+    ''', (user_id,))
+    total, successful, last = rows[0] if rows else (0, 0, None)
+    return {
+        'total_operations': total,
+        'successful_operations': successful,
+        'failed_operations': total - successful,
+        'last_operation': last
+    }
+
 # ==================== RATE LIMITING ====================
 
+# Counters live only in rate_limits so every worker process sees the same
+# count; each increment is one atomic upsert committed before it returns
+_rate_conn = None
+_rate_lock = threading.Lock()
+
 def check_rate_limit(user_id):
     """
     Check if user has exceeded rate limits
     Returns: (allowed: bool, remaining: int, reset_time: str)
     """
     try:
-        conn = sqlite3.connect('users.db')
-        cursor = conn.cursor()
-        
         # Get user's daily limit
-        cursor.execute('SELECT daily_wipe_limit, is_verified FROM users WHERE id = ?', (user_id,))
-        result = cursor.fetchone()
-        if not result:
-            conn.close()
+        rows = audit_query('SELECT daily_wipe_limit, is_verified FROM users WHERE id = ?', (user_id,))
+        if not rows:
             return False, 0, None
         
-        daily_limit, is_verified = result
+        daily_limit, is_verified = rows[0]
         
         # Get today's usage
         today = datetime.now().strftime('%Y-%m-%d')
-        cursor.execute('''
+        rows = audit_query('''
             SELECT wipe_count, last_wipe_time FROM rate_limits 
             WHERE user_id = ? AND date = ?
         ''', (user_id, today))
         
-        rate_limit = cursor.fetchone()
-        
-        if rate_limit:
-            wipe_count, last_wipe_time = rate_limit
+        if rows:
+            wipe_count, last_wipe_time = rows[0]
             
             # Check cooldown period (15 minutes between wipes)
             if last_wipe_time:
@@ -227,11 +470,9 @@ def check_rate_limit(user_id):
                 if time_since_last.total_seconds() < cooldown_minutes * 60:
                     remaining_cooldown = cooldown_minutes * 60 - time_since_last.total_seconds()
                     reset_time = (datetime.now() + timedelta(seconds=remaining_cooldown)).strftime('%H:%M:%S')
-                    conn.close()
                     return False, 0, f"Cooldown active. Wait until {reset_time}"
             
             if wipe_count >= daily_limit:
-                conn.close()
                 tomorrow = (datetime.now() + timedelta(days=1)).replace(hour=0, minute=0, second=0)
                 return False, 0, tomorrow.strftime('%Y-%m-%d %H:%M:%S')
             
@@ -239,7 +480,6 @@ def check_rate_limit(user_id):
         else:
             remaining = daily_limit
         
-        conn.close()
         return True, remaining, None
         
     except Exception as e:
@@ -247,48 +487,52 @@ def check_rate_limit(user_id):
         return False, 0, None
 
 def increment_rate_limit(user_id):
-    """Increment the rate limit counter after a successful wipe"""
+    """
+    Increment the rate limit counter after a successful wipe
+    Returns the user's wipe count for today, or None on error
+    """
+    global _rate_conn
     try:
-        conn = sqlite3.connect('users.db')
-        cursor = conn.cursor()
-        
         today = datetime.now().strftime('%Y-%m-%d')
         now = datetime.now().isoformat()
         
-        cursor.execute('''
-            INSERT INTO rate_limits (user_id, date, wipe_count, last_wipe_time)
-            VALUES (?, ?, 1, ?)
-            ON CONFLICT(user_id, date) DO UPDATE SET
-                wipe_count = wipe_count + 1,
-                last_wipe_time = ?
-        ''', (user_id, today, now, now))
-        
-        # Update total wipes
-        cursor.execute('UPDATE users SET total_wipes = total_wipes + 1 WHERE id = ?', (user_id,))
-        
-        conn.commit()
-        conn.close()
-        return True
+        with _rate_lock:
+            if _rate_conn is None:
+                _rate_conn = sqlite3.connect(AUDIT_DB, timeout=30, isolation_level=None, check_same_thread=False)
+            _rate_conn.execute('BEGIN IMMEDIATE')
+            try:
+                wipe_count = _rate_conn.execute('''
+                    INSERT INTO rate_limits (user_id, date, wipe_count, last_wipe_time)
+                    VALUES (?, ?, 1, ?)
+                    ON CONFLICT(user_id, date) DO UPDATE SET
+                        wipe_count = wipe_count + 1,
+                        last_wipe_time = excluded.last_wipe_time
+                    RETURNING wipe_count
+                ''', (user_id, today, now)).fetchone()[0]
+                
+                # Update total wipes
+                _rate_conn.execute('UPDATE users SET total_wipes = total_wipes + 1 WHERE id = ?', (user_id,))
+                _rate_conn.execute('COMMIT')
+            except Exception:
+                _rate_conn.execute('ROLLBACK')
+                raise
+        return wipe_count
     except Exception as e:
         print(f"Rate limit increment error: {e}")
-        return False
+        return None
 
 # ==================== SUSPICIOUS ACTIVITY DETECTION ====================
 
 def check_suspicious_activity(user_id, operation_type, ip_address, geo_info):
     """Detect and flag suspicious activity patterns"""
     try:
-        conn = sqlite3.connect('users.db')
-        cursor = conn.cursor()
-        
         flags = []
         
         # Check 1: High frequency usage (more than 5 wipes in 24 hours)
-        cursor.execute('''
+        recent_count = audit_query('''
             SELECT COUNT(*) FROM audit_logs 
             WHERE user_id = ? AND timestamp > datetime('now', '-24 hours')
-        ''', (user_id,))
-        recent_count = cursor.fetchone()[0]
+        ''', (user_id,))[0][0]
         
         if recent_count > 5:
             flags.append({
@@ -298,12 +542,11 @@ def check_suspicious_activity(user_id, operation_type, ip_address, geo_info):
             })
         
         # Check 2: Multiple IP addresses or locations
-        cursor.execute('''
+        ip_count, country_count = audit_query('''
             SELECT COUNT(DISTINCT ip_address), COUNT(DISTINCT country_code) 
             FROM audit_logs 
             WHERE user_id = ? AND timestamp > datetime('now', '-7 days')
-        ''', (user_id,))
-        ip_count, country_count = cursor.fetchone()
+        ''', (user_id,))[0]
         
         if ip_count > 5:
             flags.append({
@@ -320,7 +563,7 @@ def check_suspicious_activity(user_id, operation_type, ip_address, geo_info):
             })
         
         # Check 3: VPN/Proxy usage
-        if is_vpn_or_proxy(ip_address):
+        if is_vpn_or_proxy(ip_address, geo_info):
             flags.append({
                 'type': 'vpn_usage',
                 'severity': 'medium',
@@ -336,16 +579,14 @@ def check_suspicious_activity(user_id, operation_type, ip_address, geo_info):
                 'description': f'Operation at unusual hour: {current_hour}:00'
             })
         
-        # Log suspicious activities
-        for flag in flags:
-            cursor.execute('''
+        # Log suspicious activities; these are on disk before anything acts on them
+        for i, flag in enumerate(flags):
+            audit_writer.submit('''
                 INSERT INTO suspicious_activity (
                     user_id, activity_type, severity, description, ip_address
                 ) VALUES (?, ?, ?, ?, ?)
-            ''', (user_id, flag['type'], flag['severity'], flag['description'], ip_address))
-        
-        conn.commit()
-        conn.close()
+            ''', (user_id, flag['type'], flag['severity'], flag['description'], ip_address),
+               wait=(i == len(flags) - 1))
         
         # Auto-suspend account if high severity flags
         high_severity_count = sum(1 for f in flags if f['severity'] == 'high')
@@ -583,6 +824,8 @@ def require_rate_limit(f):
         
         allowed, remaining, reset_time = check_rate_limit(session['user_id'])
         if not allowed:
+            log_audit_event(session['user_id'], session.get('username'), 'rate_limit_exceeded',
+                            durable=True, success=0)
             return jsonify({
                 'success': False,
                 'message': f'Rate limit exceeded. Reset time: {reset_time}',
@@ -0,0 +1,118 @@
+"""
+Test Evidence Acquisition Placement (wipeEngine --acquire)
+Checks that the image is refused when it would land on the device being
+acquired: on a partition of that device, or on a loop device whose backing
+file lives there. Needs root, loop devices and mkfs.ext4.
+
+Build the engine first (see wipingEngine/BUILD.md); set WIPE_ENGINE to use
+another binary.
+"""
+
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+ENGINE = os.environ.get('WIPE_ENGINE', os.path.join('wipingEngine', 'wipeEngine'))
+
+def run(*cmd):
+    return subprocess.run(list(cmd), check=True, capture_output=True, text=True).stdout.strip()
+
+def partition_node(loop):
+    """Adds partition 1 of a loop device and returns its node (created by hand without udev)"""
+    name = os.path.basename(loop)
+    subprocess.run(['partx', '-a', loop], capture_output=True)
+    node = f'{loop}p1'
+    if not os.path.exists(node):
+        major, minor = open(f'/sys/block/{name}/{name}p1/dev').read().split(':')
+        os.mknod(node, 0o600 | 0o60000, os.makedev(int(major), int(minor)))
+    return node
+
+def acquire(source, image):
+    result = subprocess.run([ENGINE, '--acquire', source, '-', f'--image={image}'],
+                            capture_output=True, text=True, timeout=300)
+    return result.returncode, result.stdout + result.stderr
+
+print("="*80)
+print("🧾 ACQUISITION PLACEMENT TEST")
+print("="*80)
+
+if not os.path.exists(ENGINE):
+    print(f"❌ Engine not found at {ENGINE}")
+    sys.exit(1)
+if os.geteuid() != 0 or not shutil.which('losetup') or not shutil.which('mkfs.ext4'):
+    print("   Skipped: needs root, losetup and mkfs.ext4")
+    sys.exit(0)
+
+work = tempfile.mkdtemp(prefix='acquire_test_')
+disk = os.path.join(work, 'disk.img')
+outer_mnt = os.path.join(work, 'outer')
+inner_mnt = os.path.join(work, 'inner')
+os.makedirs(outer_mnt)
+os.makedirs(inner_mnt)
+# 256MB disk with one MBR partition from sector 2048 to the end
+with open(disk, 'wb') as f:
+    f.truncate(256 * 1024 * 1024)
+    entry = struct.pack('<B3sB3sII', 0, b'\0\0\0', 0x83, b'\0\0\0', 2048, 256 * 2048 - 2048)
+    f.write(b'\0' * 446 + entry + b'\0' * 48 + b'\x55\xaa')
+
+failures = 0
+loop = inner_loop = part = None
+mounted = []
+try:
+    loop = run('losetup', '-f', '--show', disk)
+    part = partition_node(loop)
+    run('mkfs.ext4', '-q', part)
+    run('mount', part, outer_mnt)
+    mounted.append(outer_mnt)
+
+    print("\nTEST 1: Image on a partition of the source device")
+    print("-" * 80)
+    image = os.path.join(outer_mnt, 'evidence.raw')
+    code, output = acquire(loop, image)
+    refused = code != 0 and 'must not be stored' in output and not os.path.exists(image)
+    print(f"   {'✅ refused' if refused else '❌ IMAGE WRITTEN ONTO THE SOURCE'}")
+    failures += not refused
+
+    print("\nTEST 2: Image on a loop device backed by a file on the source")
+    print("-" * 80)
+    backing = os.path.join(outer_mnt, 'inner.img')
+    with open(backing, 'wb') as f:
+        f.truncate(64 * 1024 * 1024)
+    inner_loop = run('losetup', '-f', '--show', backing)
+    run('mkfs.ext4', '-q', inner_loop)
+    run('mount', inner_loop, inner_mnt)
+    mounted.append(inner_mnt)
+    image = os.path.join(inner_mnt, 'evidence.raw')
+    code, output = acquire(loop, image)
+    refused = code != 0 and 'must not be stored' in output and not os.path.exists(image)
+    print(f"   {'✅ refused' if refused else '❌ IMAGE WRITTEN ONTO THE SOURCE'}")
+    failures += not refused
+
+    print("\nTEST 3: Image on another device is still allowed")
+    print("-" * 80)
+    image = os.path.join(work, 'evidence.raw')
+    code, output = acquire(loop, image)
+    ok = code == 0 and 'ACQUIRE_JSON' in output and os.path.getsize(image) > 0
+    print(f"   {'✅ acquired' if ok else '❌ FAILED: ' + output[-300:]}")
+    failures += not ok
+finally:
+    if inner_mnt in mounted:
+        subprocess.run(['umount', inner_mnt])
+    if inner_loop:
+        subprocess.run(['losetup', '-d', inner_loop])
+    if outer_mnt in mounted:
+        subprocess.run(['umount', outer_mnt])
+    if loop:
+        subprocess.run(['partx', '-d', loop], capture_output=True)
+        if part and os.path.exists(part):
+            os.unlink(part)
+        subprocess.run(['losetup', '-d', loop])
+    shutil.rmtree(work, ignore_errors=True)
+
+print("="*80)
+print("✅ All acquisition tests passed" if not failures else f"❌ {failures} acquisition test(s) failed")
+print("="*80)
+sys.exit(1 if failures else 0)
@@ -0,0 +1,68 @@
+"""
+Test ISA Kernel Dispatch (wipeEngine --selftest)
+Runs the self-test on this machine and, when an aarch64 cross compiler and
+qemu-user are installed, builds the engine for the ARMv8.0 baseline and runs
+it with SVE switched on and off to check the run-time selection.
+
+Build the engine first (see wipingEngine/BUILD.md); set WIPE_ENGINE to use
+another binary.
+"""
+
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ENGINE = os.environ.get('WIPE_ENGINE', os.path.join('wipingEngine', 'wipeEngine'))
+SOURCE = os.path.join('wipingEngine', 'wipeEngine.c')
+
+def selftest(cmd):
+    result = subprocess.run(cmd + ['--selftest'], capture_output=True, text=True, timeout=600)
+    for line in result.stdout.splitlines():
+        if line.startswith('SELFTEST_JSON '):
+            return result.returncode, json.loads(line[len('SELFTEST_JSON '):])
+    return result.returncode, None
+
+print("="*80)
+print("🧪 ISA KERNEL DISPATCH TEST")
+print("="*80)
+
+failures = 0
+
+print("\nTEST 1: Every level on this CPU matches the portable kernels")
+print("-" * 80)
+if not os.path.exists(ENGINE):
+    print(f"❌ Engine not found at {ENGINE}")
+    sys.exit(1)
+code, summary = selftest([ENGINE])
+ok = code == 0 and summary is not None and summary['failures'] == 0
+print(f"   Levels: {summary['levels'] if summary else '?'} → {'✅ pass' if ok else '❌ FAIL'}")
+failures += not ok
+
+print("\nTEST 2: ARM64 baseline build under qemu-user, SVE on and off")
+print("-" * 80)
+cc = shutil.which('aarch64-linux-gnu-gcc')
+qemu = shutil.which('qemu-aarch64') or shutil.which('qemu-aarch64-static')
+if not cc or not qemu:
+    print("   Skipped: needs aarch64-linux-gnu-gcc and qemu-aarch64")
+else:
+    work = tempfile.mkdtemp(prefix='isa_test_')
+    binary = os.path.join(work, 'wipeEngine_arm64')
+    try:
+        subprocess.run([cc, '-O2', '-march=armv8-a', '-static', '-pthread', SOURCE, '-o', binary], check=True)
+        for sve, expect_sve in (('sve=on', True), ('sve=off', False)):
+            code, summary = selftest([qemu, '-cpu', f'max,{sve}', binary])
+            ok = (code == 0 and summary is not None and summary['failures'] == 0
+                  and ('sve' in summary['levels']) == expect_sve and 'neon' in summary['levels']
+                  and summary['sha256'] == 'ARMv8 SHA2')
+            print(f"   -cpu max,{sve}: {summary['levels'] if summary else '?'} → {'✅ pass' if ok else '❌ FAIL'}")
+            failures += not ok
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+print("="*80)
+print("✅ All ISA tests passed" if not failures else f"❌ {failures} ISA test(s) failed")
+print("="*80)
+sys.exit(1 if failures else 0)
@@ -0,0 +1,95 @@
+"""
+Test Quarantine Watch Mode (wipeEngine --watch)
+Checks that a producer who swaps a watched directory for a symbolic link
+cannot make the watcher overwrite or delete files outside the watched tree.
+
+Build the engine first (see wipingEngine/BUILD.md); set WIPE_ENGINE to use
+another binary.
+"""
+
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+ENGINE = os.environ.get('WIPE_ENGINE', os.path.join('wipingEngine', 'wipeEngine'))
+
+def wait_for(predicate, timeout=30):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if predicate():
+            return True
+        time.sleep(0.05)
+    return False
+
+print("="*80)
+print("👁️  QUARANTINE WATCH TEST")
+print("="*80)
+
+if not os.path.exists(ENGINE):
+    print(f"❌ Engine not found at {ENGINE}")
+    sys.exit(1)
+
+work = tempfile.mkdtemp(prefix='watch_test_')
+quarantine = os.path.join(work, 'quarantine')
+victim_dir = os.path.join(work, 'outside')
+moved_dir = os.path.join(work, 'moved_away')
+os.makedirs(os.path.join(quarantine, 'drop'))
+os.makedirs(victim_dir)
+victim = os.path.join(victim_dir, 'precious.txt')
+with open(victim, 'w') as f:
+    f.write('must survive\n' * 1000)
+
+log = open(os.path.join(work, 'engine.log'), 'w+')
+engine = subprocess.Popen([ENGINE, '--watch', quarantine, '--purge', '--writers=1'],
+                          stdout=log, stderr=subprocess.STDOUT)
+failures = 0
+try:
+    if not wait_for(lambda: 'Watching' in open(log.name).read()):
+        raise RuntimeError('watcher did not start')
+
+    print("\nTEST 1: Directory swapped for a symlink while its file is queued")
+    print("-" * 80)
+    # A large file keeps the single writer busy, so the next file waits in the queue
+    with open(os.path.join(quarantine, 'big.bin'), 'wb') as f:
+        f.write(os.urandom(1024 * 1024) * 256)
+    with open(os.path.join(quarantine, 'drop', 'precious.txt'), 'w') as f:
+        f.write('dropped\n')
+    # Move the real directory out of the tree and point its name at the victim
+    os.rename(os.path.join(quarantine, 'drop'), moved_dir)
+    os.symlink(victim_dir, os.path.join(quarantine, 'drop'))
+
+    wait_for(lambda: not os.path.exists(os.path.join(quarantine, 'big.bin')), timeout=120)
+    wait_for(lambda: not os.path.exists(os.path.join(moved_dir, 'precious.txt')), timeout=30)
+    intact = os.path.exists(victim) and open(victim).read() == 'must survive\n' * 1000
+    print(f"   File outside the tree: {'✅ untouched' if intact else '❌ OVERWRITTEN OR DELETED'}")
+    failures += not intact
+
+    print("\nTEST 2: Hard link to a file outside the tree")
+    print("-" * 80)
+    link = os.path.join(quarantine, 'link.txt')
+    try:
+        os.link(victim, link)
+        open(link, 'a').close()  # Closing it after writing is what the watcher reacts to
+        wait_for(lambda: 'hard link' in open(log.name).read(), timeout=30)
+        intact = open(victim).read() == 'must survive\n' * 1000
+        print(f"   Linked file: {'✅ untouched' if intact else '❌ OVERWRITTEN'}")
+        failures += not intact
+    except OSError as e:
+        print(f"   Skipped: {e}")
+finally:
+    engine.send_signal(signal.SIGINT)
+    engine.wait(timeout=60)
+    log.seek(0)
+    print("\nEngine output:")
+    print(log.read())
+    log.close()
+    shutil.rmtree(work, ignore_errors=True)
+
+print("="*80)
+print("✅ All watch tests passed" if not failures else f"❌ {failures} watch test(s) failed")
+print("="*80)
+sys.exit(1 if failures else 0)
@@ -6,44 +6,139 @@ Allows independent verification of data wiping certificates
 import sqlite3
 import hashlib
 import json
-from datetime import datetime
+import threading
+from collections import OrderedDict
+from datetime import datetime, timedelta
 
-# Initialize verification database
-def init_verification_db():
-    """Create verification database for storing certificate hashes"""
-    conn = sqlite3.connect('verification.db')
-    cursor = conn.cursor()
+VERIFICATION_DB = 'verification.db'
+VERIFY_CACHE_SIZE = 4096     # verified certificates kept in memory
+STATS_WINDOW_DAYS = 30
+
+# One long-lived WAL connection shared by the request threads. sqlite3 keeps a
+# per-connection statement cache, so the fixed SQL below is prepared only once.
+_conn = None
+_db_lock = threading.RLock()
+
+# LRU of certificate_id -> record, plus verification_code -> certificate_id
+_cert_cache = OrderedDict()
+_code_index = {}
+
+# Statistics loaded from the database once, then maintained incrementally
+_stats = None
+
+RECORD_FIELDS = ('certificate_id', 'certificate_hash', 'verification_code', 'issue_date',
+                 'technician', 'asset_path', 'wipe_method', 'verification_count')
+
+
+def _get_connection():
+    global _conn
+    if _conn is None:
+        _conn = sqlite3.connect(VERIFICATION_DB, check_same_thread=False, cached_statements=64)
+        _conn.execute('PRAGMA journal_mode=WAL')
+        _conn.execute('PRAGMA synchronous=NORMAL')
+    return _conn
+
+
+def _cache_put(record):
+    _cert_cache[record['certificate_id']] = record
+    _cert_cache.move_to_end(record['certificate_id'])
+    _code_index[record['verification_code']] = record['certificate_id']
+    while len(_cert_cache) > VERIFY_CACHE_SIZE:
+        _, evicted = _cert_cache.popitem(last=False)
+        _code_index.pop(evicted['verification_code'], None)
+
+
+def _cache_drop(certificate_id):
+    record = _cert_cache.pop(certificate_id, None)
+    if record:
+        _code_index.pop(record['verification_code'], None)
+
+
+def _lookup_certificate(column, value):
+    """Find a certificate record by certificate_id or verification_code (caller holds _db_lock)"""
+    certificate_id = _code_index.get(value) if column == 'verification_code' else value
+    record = _cert_cache.get(certificate_id)
+    if record:
+        _cert_cache.move_to_end(certificate_id)
+        return record
     
-    cursor.execute('''
-        CREATE TABLE IF NOT EXISTS verified_certificates (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            certificate_id TEXT UNIQUE NOT NULL,
-            certificate_hash TEXT NOT NULL,
-            verification_code TEXT UNIQUE NOT NULL,
-            issue_date TEXT NOT NULL,
-            technician TEXT,
-            asset_path TEXT,
-            wipe_method TEXT,
-            created_at TEXT DEFAULT CURRENT_TIMESTAMP,
-            verification_count INTEGER DEFAULT 0,
-            last_verified TEXT
-        )
-    ''')
+    row = _get_connection().execute(f'''
+        SELECT certificate_id, certificate_hash, verification_code, issue_date,
+               technician, asset_path, wipe_method, verification_count
+        FROM verified_certificates
+        WHERE {column} = ?
+    ''', (value,)).fetchone()
+    if not row:
+        return None
+    
+    record = dict(zip(RECORD_FIELDS, row))
+    _cache_put(record)
+    return record
+
+
+def _load_statistics():
+    """Seed the in-memory statistics from the database (caller holds _db_lock)"""
+    global _stats
+    cursor = _get_connection().cursor()
+    
+    cursor.execute('SELECT COUNT(*), SUM(verification_count) FROM verified_certificates')
+    total_certs, total_verifications = cursor.fetchone()
     
+    # Recent attempts are kept as per-day buckets so the window can slide
     cursor.execute('''
-        CREATE TABLE IF NOT EXISTS verification_logs (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            certificate_id TEXT NOT NULL,
-            verification_code TEXT NOT NULL,
-            verifier_ip TEXT,
-            verifier_location TEXT,
-            verification_time TEXT DEFAULT CURRENT_TIMESTAMP,
-            verification_result TEXT
-        )
-    ''')
+        SELECT date(verification_time), COUNT(*) FROM verification_logs
+        WHERE verification_time > datetime('now', ?)
+        GROUP BY date(verification_time)
+    ''', (f'-{STATS_WINDOW_DAYS} days',))
     
-    conn.commit()
-    conn.close()
+    _stats = {
+        'total_certificates': total_certs,
+        'total_verifications': total_verifications or 0,
+        'attempts_per_day': dict(cursor.fetchall())
+    }
+
+
+# Initialize verification database
+def init_verification_db():
+    """Create verification database for storing certificate hashes"""
+    with _db_lock:
+        conn = _get_connection()
+        cursor = conn.cursor()
+        
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS verified_certificates (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                certificate_id TEXT UNIQUE NOT NULL,
+                certificate_hash TEXT NOT NULL,
+                verification_code TEXT UNIQUE NOT NULL,
+                issue_date TEXT NOT NULL,
+                technician TEXT,
+                asset_path TEXT,
+                wipe_method TEXT,
+                created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+                verification_count INTEGER DEFAULT 0,
+                last_verified TEXT
+            )
+        ''')
+        
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS verification_logs (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                certificate_id TEXT NOT NULL,
+                verification_code TEXT NOT NULL,
+                verifier_ip TEXT,
+                verifier_location TEXT,
+                verification_time TEXT DEFAULT CURRENT_TIMESTAMP,
+                verification_result TEXT
+            )
+        ''')
+        
+        # certificate_id and verification_code are UNIQUE and therefore indexed;
+        # the audit log is looked up per certificate and by time window
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_verification_logs_cert ON verification_logs(certificate_id)')
+        cursor.execute('CREATE INDEX IF NOT EXISTS idx_verification_logs_time ON verification_logs(verification_time)')
+        
+        conn.commit()
 
 
 def generate_verification_code(certificate_id, certificate_data):
@@ -69,10 +164,6 @@ def register_certificate_for_verification(cert_data):
     Returns verification code
     """
     try:
-        init_verification_db()
-        conn = sqlite3.connect('verification.db')
-        cursor = conn.cursor()
-        
         certificate_id = cert_data.get('certificate_id', '')
         
         # Generate certificate hash for integrity check
@@ -82,27 +173,42 @@ def register_certificate_for_verification(cert_data):
         # Generate verification code
         verification_code = generate_verification_code(certificate_id, cert_json)
         
-        # Store in database
-        cursor.execute('''
-            INSERT OR REPLACE INTO verified_certificates 
-            (certificate_id, certificate_hash, verification_code, issue_date, 
-             technician, asset_path, wipe_method)
-            VALUES (?, ?, ?, ?, ?, ?, ?)
-        ''', (
-            certificate_id,
-            cert_hash,
-            verification_code,
-            cert_data.get('timestamp', datetime.now().isoformat()),
-            cert_data.get('technician', 'Unknown'),
-            cert_data.get('asset', {}).get('path', 'Unknown'),
-            cert_data.get('wipe_details', {}).get('method', 'Unknown')
-        ))
-        
-        conn.commit()
-        conn.close()
+        with _db_lock:
+            conn = _get_connection()
+            cursor = conn.cursor()
+            
+            # INSERT OR REPLACE resets the row, so retire its old count first
+            cursor.execute('SELECT verification_count FROM verified_certificates WHERE certificate_id = ?',
+                           (certificate_id,))
+            previous = cursor.fetchone()
+            
+            # Store in database
+            cursor.execute('''
+                INSERT OR REPLACE INTO verified_certificates
+                (certificate_id, certificate_hash, verification_code, issue_date,
+                 technician, asset_path, wipe_method)
+                VALUES (?, ?, ?, ?, ?, ?, ?)
+            ''', (
+                certificate_id,
+                cert_hash,
+                verification_code,
+                cert_data.get('timestamp', datetime.now().isoformat()),
+                cert_data.get('technician', 'Unknown'),
+                cert_data.get('asset', {}).get('path', 'Unknown'),
+                cert_data.get('wipe_details', {}).get('method', 'Unknown')
+            ))
+            
+            conn.commit()
+            
+            _cache_drop(certificate_id)
+            if _stats is not None:
+                if previous:
+                    _stats['total_verifications'] -= previous[0] or 0
+                else:
+                    _stats['total_certificates'] += 1
         
         return verification_code
-        
+    
     except Exception as e:
         print(f"Error registering certificate: {e}")
         return None
@@ -114,54 +220,47 @@ def verify_certificate_by_code(verification_code):
     Returns verification result dictionary
     """
     try:
-        conn = sqlite3.connect('verification.db')
-        cursor = conn.cursor()
-        
-        # Look up certificate
-        cursor.execute('''
-            SELECT certificate_id, certificate_hash, issue_date, technician, 
-                   asset_path, wipe_method, verification_count
-            FROM verified_certificates
-            WHERE verification_code = ?
-        ''', (verification_code,))
-        
-        result = cursor.fetchone()
+        with _db_lock:
+            # Look up certificate
+            record = _lookup_certificate('verification_code', verification_code)
+            
+            if record:
+                # Update verification count
+                conn = _get_connection()
+                conn.execute('''
+                    UPDATE verified_certificates
+                    SET verification_count = verification_count + 1,
+                        last_verified = ?
+                    WHERE verification_code = ?
+                ''', (datetime.now().isoformat(), verification_code))
+                conn.commit()
+                
+                record['verification_count'] += 1
+                if _stats is not None:
+                    _stats['total_verifications'] += 1
+                record = dict(record)
         
-        if not result:
-            conn.close()
+        if not record:
             return {
                 'valid': False,
                 'message': 'Invalid verification code. Certificate not found in verification database.',
                 'status': 'NOT_FOUND'
             }
         
-        cert_id, cert_hash, issue_date, technician, asset_path, wipe_method, ver_count = result
-        
-        # Update verification count
-        cursor.execute('''
-            UPDATE verified_certificates 
-            SET verification_count = verification_count + 1,
-                last_verified = ?
-            WHERE verification_code = ?
-        ''', (datetime.now().isoformat(), verification_code))
-        
-        conn.commit()
-        conn.close()
-        
         return {
             'valid': True,
             'message': 'Certificate is authentic and verified.',
             'status': 'VERIFIED',
             'certificate_details': {
-                'certificate_id': cert_id,
-                'issue_date': issue_date,
-                'technician': technician,
-                'asset_path': asset_path,
-                'wipe_method': wipe_method,
-                'verification_count': ver_count + 1
+                'certificate_id': record['certificate_id'],
+                'issue_date': record['issue_date'],
+                'technician': record['technician'],
+                'asset_path': record['asset_path'],
+                'wipe_method': record['wipe_method'],
+                'verification_count': record['verification_count']
             }
         }
-        
+    
     except Exception as e:
         return {
             'valid': False,
@@ -175,43 +274,33 @@ def verify_certificate_by_id(certificate_id):
     Verify a certificate using its ID
     """
     try:
-        conn = sqlite3.connect('verification.db')
-        cursor = conn.cursor()
-        
-        cursor.execute('''
-            SELECT certificate_hash, verification_code, issue_date, technician, 
-                   asset_path, wipe_method, verification_count
-            FROM verified_certificates
-            WHERE certificate_id = ?
-        ''', (certificate_id,))
+        with _db_lock:
+            record = _lookup_certificate('certificate_id', certificate_id)
+            if record:
+                record = dict(record)
         
-        result = cursor.fetchone()
-        conn.close()
-        
-        if not result:
+        if not record:
             return {
                 'valid': False,
                 'message': 'Certificate ID not found in verification database.',
                 'status': 'NOT_FOUND'
             }
         
-        cert_hash, ver_code, issue_date, technician, asset_path, wipe_method, ver_count = result
-        
         return {
             'valid': True,
             'message': 'Certificate found and verified.',
             'status': 'VERIFIED',
-            'verification_code': ver_code,
+            'verification_code': record['verification_code'],
             'certificate_details': {
                 'certificate_id': certificate_id,
-                'issue_date': issue_date,
-                'technician': technician,
-                'asset_path': asset_path,
-                'wipe_method': wipe_method,
-                'verification_count': ver_count
+                'issue_date': record['issue_date'],
+                'technician': record['technician'],
+                'asset_path': record['asset_path'],
+                'wipe_method': record['wipe_method'],
+                'verification_count': record['verification_count']
             }
         }
-        
+    
     except Exception as e:
         return {
             'valid': False,
@@ -223,18 +312,20 @@ def verify_certificate_by_id(certificate_id):
 def log_verification_attempt(cert_id, ver_code, ip, location, result):
     """Log a verification attempt for audit purposes"""
     try:
-        conn = sqlite3.connect('verification.db')
-        cursor = conn.cursor()
-        
-        cursor.execute('''
-            INSERT INTO verification_logs 
-            (certificate_id, verification_code, verifier_ip, verifier_location, verification_result)
-            VALUES (?, ?, ?, ?, ?)
-        ''', (cert_id, ver_code, ip, location, result))
-        
-        conn.commit()
-        conn.close()
-        
+        with _db_lock:
+            conn = _get_connection()
+            conn.execute('''
+                INSERT INTO verification_logs
+                (certificate_id, verification_code, verifier_ip, verifier_location, verification_result)
+                VALUES (?, ?, ?, ?, ?)
+            ''', (cert_id, ver_code, ip, location, result))
+            conn.commit()
+            
+            if _stats is not None:
+                # verification_time defaults to CURRENT_TIMESTAMP, which is UTC
+                today = datetime.utcnow().strftime('%Y-%m-%d')
+                _stats['attempts_per_day'][today] = _stats['attempts_per_day'].get(today, 0) + 1
+    
     except Exception as e:
         print(f"Error logging verification: {e}")
 
@@ -242,29 +333,21 @@ def log_verification_attempt(cert_id, ver_code, ip, location, result):
 def get_verification_statistics():
     """Get overall verification statistics"""
     try:
-        conn = sqlite3.connect('verification.db')
-        cursor = conn.cursor()
-        
-        cursor.execute('SELECT COUNT(*) FROM verified_certificates')
-        total_certs = cursor.fetchone()[0]
-        
-        cursor.execute('SELECT SUM(verification_count) FROM verified_certificates')
-        total_verifications = cursor.fetchone()[0] or 0
-        
-        cursor.execute('''
-            SELECT COUNT(*) FROM verification_logs 
-            WHERE verification_time > datetime('now', '-30 days')
-        ''')
-        recent_verifications = cursor.fetchone()[0]
-        
-        conn.close()
-        
-        return {
-            'total_certificates': total_certs,
-            'total_verifications': total_verifications,
-            'recent_verifications_30d': recent_verifications
-        }
-        
+        with _db_lock:
+            if _stats is None:
+                _load_statistics()
+            
+            # Drop the day buckets that have slid out of the window
+            cutoff = (datetime.utcnow() - timedelta(days=STATS_WINDOW_DAYS)).strftime('%Y-%m-%d')
+            for day in [d for d in _stats['attempts_per_day'] if d < cutoff]:
+                del _stats['attempts_per_day'][day]
+            
+            return {
+                'total_certificates': _stats['total_certificates'],
+                'total_verifications': _stats['total_verifications'],
+                'recent_verifications_30d': sum(_stats['attempts_per_day'].values())
+            }
+    
     except Exception as e:
         return {
             'error': str(e)